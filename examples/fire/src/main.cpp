@@ -51,7 +51,7 @@ inline void set_pixel(std::vector<Gempyre::Color::type>& vec, int x, int y, int
     vec[y * w + x] = col;
 }
 
-void draw_fire(Gempyre::Bitmap& target, std::vector<Gempyre::Color::type>& fire) {
+void draw_fire(Gempyre::IndexedBitmap& target, std::vector<Gempyre::Color::type>& fire) {
     const auto h = target.height();
     const auto w = target.width();    
     for(auto y = 1; y < h - 3; y++) {
@@ -65,16 +65,16 @@ void draw_fire(Gempyre::Bitmap& target, std::vector<Gempyre::Color::type>& fire)
     }
 }
 
+// palette is in the target, the UI expands indices to colors
 void draw_frame(
     Gempyre::CanvasElement& canvas,
-    Gempyre::Bitmap& target,
-    std::vector<Gempyre::Color::type>& fire,
-    const std::array<Gempyre::Color::type, 256>& palette) {
+    Gempyre::IndexedBitmap& target,
+    std::vector<Gempyre::Color::type>& fire) {
         const auto h = target.height();
         const auto w = target.width();    
         for(auto y = 0; y < h; y++) {
             for(auto x = 0; x < w; x++)  {
-                target.set_pixel(x, y, palette[pixel(fire, x, y, w)]);
+                target.set_index(x, y, static_cast<uint8_t>(pixel(fire, x, y, w)));
             }
         }
     canvas.draw(0, 0, target);
@@ -91,15 +91,14 @@ void draw_fps(Gempyre::Ui& ui, unsigned& fps_count, Time& start) {
     }
 }
 
-void amain( Gempyre::Ui& ui, Gempyre::CanvasElement& canvas_element, const Gempyre::Bitmap& bmp, unsigned& fps_count, Time& start, std::weak_ptr<Gempyre::Bitmap>& target_ref) {
+void amain( Gempyre::Ui& ui, Gempyre::CanvasElement& canvas_element, const Gempyre::Bitmap& bmp, unsigned& fps_count, Time& start, std::weak_ptr<Gempyre::IndexedBitmap>& target_ref) {
     const auto rect = canvas_element.rect();
     gempyre_utils_assert(rect);
-    auto palette = make_palette();
     auto fire_buffer = std::make_shared<std::vector<Gempyre::Color::type>>(rect->width * rect->height);
-    auto canvas = std::make_shared<Gempyre::Bitmap>(rect->width, rect->height);
+    auto canvas = std::make_shared<Gempyre::IndexedBitmap>(rect->width, rect->height, make_palette());
     target_ref = canvas; // bind to weak;
-    canvas_element.draw_completed([canvas_element, canvas, fire_buffer, palette = std::move(palette), &fps_count]() mutable {
-        draw_frame(canvas_element, *canvas, *fire_buffer, palette);
+    canvas_element.draw_completed([canvas_element, canvas, fire_buffer, &fps_count]() mutable {
+        draw_frame(canvas_element, *canvas, *fire_buffer);
         ++fps_count;
     }, Gempyre::CanvasElement::DrawNotify::Kick);
     ui.start_periodic(50ms, [&ui, rect, fire_buffer, &bmp, canvas, &start, &fps_count]() {
@@ -107,15 +106,17 @@ void amain( Gempyre::Ui& ui, Gempyre::CanvasElement& canvas_element, const Gempy
         draw_fire(*canvas, fire);
         const auto left = (rect->width - bmp.width()) / 2;
         const auto top = (rect->height - bmp.height()) / 2;
-        for(int y = 0; y < bmp.height(); ++y)
+        for(int y = 0; y < bmp.height(); ++y) {
+            const auto row = bmp.const_row(y); // direct access, not a call per pixel
             for(int x = 0; x < bmp.width(); ++x) {
-                const auto px = bmp.pixel(x, y);
+                const auto px = row[static_cast<size_t>(x)];
                 if (px != Gempyre::Color::Black) {
                     const auto sat = Gempyre::Color::r(px) + Gempyre::Color::g(px) + Gempyre::Color::b(px); 
                     set_pixel(fire, left + x, top + y, rect->width,
                      std::abs(32768 + std::rand()) % (sat / 3));
                 }
             }
+        }
 
         draw_fps(ui, fps_count, start);
         });
@@ -131,7 +132,7 @@ int main(int /*argc*/, char** /*argv*/) {
     unsigned fps_count = 0;
     auto start = std::chrono::steady_clock::now();
 
-    std::weak_ptr<Gempyre::Bitmap> target_ref; // refer to target bitmap
+    std::weak_ptr<Gempyre::IndexedBitmap> target_ref; // refer to target bitmap
 
     Gempyre::Element(ui, "do_save").subscribe(Gempyre::Event::CLICK, [&](auto) {
         if(target_ref.use_count() == 0)  // do we have image?
@@ -144,7 +145,7 @@ int main(int /*argc*/, char** /*argv*/) {
                 std::cerr << "Cannot write to " << *file;
                 return; 
             }
-            const auto png_data = target_ref.lock()->png_image();   // get data from weak pointer referenced bitmap
+            const auto png_data = target_ref.lock()->to_bitmap().png_image();   // get data from weak pointer referenced bitmap
             out.write(reinterpret_cast<const char*>(png_data.data()), png_data.size()); // write data
         }
     });
@@ -9,6 +9,9 @@
 #include <string_view>
 #include <vector>
 #include <type_traits>
+#include <cstddef>
+#include <cmath>
+#include <iterator>
 #include <algorithm>
 
 /**
@@ -34,6 +37,8 @@
 
 namespace  Gempyre {
     class CanvasElement;
+    class VirtualCanvas;
+    class BitmapView;
 
     /// @brief RGB handling
     namespace  Color {
@@ -273,6 +278,223 @@ namespace  Gempyre {
 
     }
 
+    /// @brief Compositing operators, @see Bitmap::blend()
+    /// @details Porter-Duff operators with source as the drawn bitmap and destination as this bitmap,
+    /// as in <a href="https://developer.mozilla.org/en-US/docs/Web/API/CanvasRenderingContext2D/globalCompositeOperation">globalCompositeOperation</a>.
+    enum class BlendMode {
+        Clear,              ///< result is transparent
+        Source,             ///< source replaces destination
+        Destination,        ///< destination is kept
+        SourceOver,         ///< source is drawn over destination
+        DestinationOver,    ///< source is drawn behind destination
+        SourceIn,           ///< source where destination is
+        DestinationIn,      ///< destination where source is
+        SourceOut,          ///< source where destination is not
+        DestinationOut,     ///< destination where source is not
+        SourceAtop,         ///< source over destination, only where destination is
+        DestinationAtop,    ///< destination over source, only where source is
+        Xor,                ///< source and destination where they do not overlap
+        Add,                ///< components are added
+        Multiply            ///< colors are multiplied, alpha as in SourceOver
+    };
+
+    /// @brief Sampling of pixels when a bitmap is scaled or transformed, @see Bitmap::scaled()
+    enum class Filter {
+        Nearest,    ///< nearest pixel, fastest and keeps hard edges
+        Bilinear,   ///< interpolated between four pixels
+        Box         ///< average of covered pixels when downscaled, good for thumbnails, otherwise as Bilinear
+    };
+
+    /// @brief 2D affine transform, maps (x, y) to (a * x + c * y + e, b * x + d * y + f)
+    /// as <a href="https://developer.mozilla.org/en-US/docs/Web/API/CanvasRenderingContext2D/setTransform">setTransform</a>.
+    struct Transform {
+        double a{1};
+        double b{0};
+        double c{0};
+        double d{1};
+        double e{0};
+        double f{0};
+        /// Translation.
+        static Transform translate(double x, double y) {return {1, 0, 0, 1, x, y};}
+        /// Scaling.
+        static Transform scale(double x, double y) {return {x, 0, 0, y, 0, 0};}
+        /// Rotation, clockwise in radians.
+        static Transform rotate(double angle) {
+            const auto cos = std::cos(angle);
+            const auto sin = std::sin(angle);
+            return {cos, sin, -sin, cos, 0, 0};
+        }
+        /// Transform that applies other first and then this.
+        Transform operator*(const Transform& o) const {
+            return {a * o.a + c * o.b, b * o.a + d * o.b,
+                    a * o.c + c * o.d, b * o.c + d * o.d,
+                    a * o.e + c * o.f + e, b * o.e + d * o.f + f};
+        }
+        /// Reverse transform, nullopt if there is none.
+        std::optional<Transform> inverse() const {
+            const auto det = a * d - b * c;
+            if(det == 0.0)
+                return std::nullopt;
+            return Transform{d / det, -b / det, -c / det, a / det, (c * f - d * e) / det, (b * e - a * f) / det};
+        }
+    };
+
+    /// @brief Point for vector drawing on a Bitmap, pixel (x, y) covers the area from (x, y) to (x + 1, y + 1).
+    struct Point {
+        double x;   ///< x coordinate.
+        double y;   ///< y coordinate.
+    };
+
+    /// @brief Which areas of a self-intersecting polygon are inside, @see Bitmap::fill_polygon()
+    enum class FillRule {
+        NonZero,    ///< areas encircled at all
+        EvenOdd     ///< areas encircled odd number of times
+    };
+
+    /// @brief PNG encoding options, @see Bitmap::png_image()
+    /// @details Defaults are as lodepng defaults, for frequent snapshots a lower compression
+    /// and RowFilter::None are much faster.
+    struct PngOptions {
+        /// @brief Filter that is applied on rows before compression.
+        enum class RowFilter {
+            None,       ///< fastest
+            Sub,        ///< difference to the left pixel
+            Up,         ///< difference to the pixel above
+            Average,    ///< difference to the average of left and above
+            Paeth,      ///< difference to the Paeth predictor
+            MinSum,     ///< the above that gives the smallest sum of differences, per row
+            Entropy     ///< the above that gives the smallest entropy, per row, slow
+        };
+        /// Compression level: 0 is stored (fastest), 9 is smallest, 4 is as lodepng default.
+        int compression{4};
+        /// Row filter.
+        RowFilter filter{RowFilter::MinSum};
+        /// MinSum filters are chosen in parallel, from RGBA rows.
+        bool threaded{true};
+        /// Smallest color type, e.g. RGB when all pixels are opaque, costs an extra pass over pixels.
+        bool optimize_color{true};
+    };
+
+    /// @brief Pixel formats of PixelBitmap, Bitmap itself is RGBA.
+    namespace PixelFormat {
+        /// 8-bit luminance, drawn on CanvasElement as one byte per pixel.
+        struct Gray8 {using value_type = uint8_t;};
+        /// 16-bit 5 bits red (high bits), 6 bits green and 5 bits blue, no alpha.
+        struct RGB565 {using value_type = uint16_t;};
+        /// 32-bit with blue in the lowest byte, as produced by many capture libraries.
+        struct BGRA {using value_type = uint32_t;};
+    }
+
+    template<class Format> class PixelBitmap;
+
+    /// @brief Contiguous pixels, e.g. a row of a Bitmap, accessed directly in memory without function calls.
+    /// @details Like std::span, the span does not own the pixels.
+    template<class T>
+    class PixelSpan {
+    public:
+        /// @brief Pixel type.
+        using value_type = std::remove_cv_t<T>;
+        /// @brief Iterator is a pointer.
+        using iterator = T*;
+
+        /// @brief Constructor - empty span.
+        PixelSpan() = default;
+
+        /// @brief Constructor.
+        /// @param data - first pixel.
+        /// @param size - number of pixels.
+        PixelSpan(T* data, std::size_t size) : m_data{data}, m_size{size} {}
+
+        /// First pixel.
+        [[nodiscard]] T* data() const {return m_data;}
+
+        /// Number of pixels.
+        [[nodiscard]] std::size_t size() const {return m_size;}
+
+        /// return true if there is no pixels
+        [[nodiscard]] bool empty() const {return m_size == 0;}
+
+        /// A pixel, index is not checked.
+        [[nodiscard]] T& operator[](std::size_t index) const {return m_data[index];}
+
+        /// Begin of pixels.
+        [[nodiscard]] T* begin() const {return m_data;}
+
+        /// End of pixels.
+        [[nodiscard]] T* end() const {return m_data + m_size;}
+
+        /// Part of the span, clipped to the span.
+        [[nodiscard]] PixelSpan subspan(std::size_t offset, std::size_t count) const {
+            offset = std::min(offset, m_size);
+            return {m_data + offset, std::min(count, m_size - offset)};
+        }
+
+    private:
+        T* m_data{nullptr};
+        std::size_t m_size{0};
+    };
+
+    /// @brief Rows of pixels as PixelSpans, for range-based for.
+    /// @note
+    /// @code{.cpp}
+    /// for(auto row : bitmap.rows())
+    ///     for(auto& pixel : row)
+    ///         pixel = Gempyre::Color::set_alpha(pixel, 0x80);
+    /// @endcode
+    template<class T>
+    class PixelRows {
+    public:
+        /// @brief Iterator of rows.
+        class iterator {
+        public:
+            /// @cond INTERNAL
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = PixelSpan<T>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = PixelSpan<T>;
+            iterator(T* row, std::size_t width, std::ptrdiff_t stride) : m_row{row}, m_width{width}, m_stride{stride} {}
+            PixelSpan<T> operator*() const {return {m_row, m_width};}
+            iterator& operator++() {m_row += m_stride; return *this;}
+            iterator operator++(int) {auto it = *this; m_row += m_stride; return it;}
+            bool operator==(const iterator& other) const {return m_row == other.m_row;}
+            bool operator!=(const iterator& other) const {return m_row != other.m_row;}
+            /// @endcond
+        private:
+            T* m_row;
+            std::size_t m_width;
+            std::ptrdiff_t m_stride;
+        };
+
+        /// @brief Constructor - no rows.
+        PixelRows() = default;
+
+        /// @brief Constructor.
+        /// @param first - first pixel of the first row.
+        /// @param width - pixels per row.
+        /// @param height - number of rows.
+        /// @param stride - distance of rows in pixels.
+        PixelRows(T* first, int width, int height, int stride) : m_first{first}, m_width{width}, m_height{height}, m_stride{stride} {}
+
+        /// First row.
+        [[nodiscard]] iterator begin() const {return {m_first, static_cast<std::size_t>(m_width), m_stride};}
+
+        /// After the last row.
+        [[nodiscard]] iterator end() const {return {m_first + static_cast<std::ptrdiff_t>(m_height) * m_stride, static_cast<std::size_t>(m_width), m_stride};}
+
+        /// Number of rows.
+        [[nodiscard]] std::size_t size() const {return static_cast<std::size_t>(m_height);}
+
+        /// A row, index is not checked.
+        [[nodiscard]] PixelSpan<T> operator[](std::size_t y) const {return {m_first + static_cast<std::ptrdiff_t>(y) * m_stride, static_cast<std::size_t>(m_width)};}
+
+    private:
+        T* m_first{nullptr};
+        int m_width{0};
+        int m_height{0};
+        int m_stride{0};
+    };
+
     /// @brief Bitmap for Gempyre Graphics
     class GEMPYRE_EX Bitmap {
     public:
@@ -293,14 +515,14 @@ namespace  Gempyre {
         /// @brief Move constructor. 
         Bitmap(Bitmap&& other) = default;
         
-        /// Copy constructor - does not copy the data, for deep copy @see clone() 
+        /// Copy constructor - pixels are shared until either bitmap is written (copy-on-write), for deep copy @see clone() 
         Bitmap(const Bitmap& other) = default;
         
         /// Destructor
         ~Bitmap();
 
         /// @brief Create bitmap from byte array. 
-        /// @param image_data PNG image in bytes.
+        /// @param image_data PNG, QOI, PPM or PAM image in bytes, @see Bitmap(const uint8_t*, size_t)
         /// @note
         /// @code{.cpp}
         /// const auto bytes = GempyreUtils::slurp<uint8_t>("image.png");
@@ -308,11 +530,47 @@ namespace  Gempyre {
         /// @endcode
         Bitmap(const std::vector<uint8_t>& image_data);
 
+        /// @brief Constructor - image from bytes.
+        /// @param bytes PNG, QOI, PPM (P6), PGM (P5) or PAM (P7) image.
+        /// @param size number of bytes.
+        /// @details The format is detected from the content. Throws std::runtime_error if the image cannot be decoded.
+        /// QOI, PPM and PAM are decoded directly into the bitmap, QOI is much faster than PNG.
+        Bitmap(const uint8_t* bytes, size_t size);
+
+        /// @brief Load an image file, @see Bitmap(const uint8_t*, size_t)
+        /// @param filename image file.
+        /// @return Bitmap, or nullopt if the file cannot be read or decoded.
+        /// @details The file is memory mapped and decoded from there, without reading it in a buffer.
+        static std::optional<Bitmap> load(std::string_view filename);
+
+        /// @brief Save an image file.
+        /// @param filename image file, format is chosen by extension: .qoi, .ppm, .pam, otherwise PNG.
+        /// @param options PNG options.
+        /// @return true if written.
+        bool save(std::string_view filename, const PngOptions& options = {}) const;
+
         /// @brief Convert a bitmap to PNG
         /// @return PNG bytes
         std::vector<uint8_t> png_image() const;
 
-        /// Copy operator does only shallow copy, for deep copy @see clone() 
+        /// @brief Convert a bitmap to PNG
+        /// @param options encoding options.
+        /// @return PNG bytes, empty if the encoding failed.
+        std::vector<uint8_t> png_image(const PngOptions& options) const;
+
+        /// @brief Convert a bitmap to <a href="https://qoiformat.org">QOI</a>, lossless and much faster than PNG.
+        /// @return QOI bytes
+        std::vector<uint8_t> qoi_image() const;
+
+        /// @brief Convert a bitmap to binary PPM (P6), alpha is dropped.
+        /// @return PPM bytes
+        std::vector<uint8_t> ppm_image() const;
+
+        /// @brief Convert a bitmap to PAM (P7) with RGB_ALPHA tuples.
+        /// @return PAM bytes
+        std::vector<uint8_t> pam_image() const;
+
+        /// Copy operator - pixels are shared until either bitmap is written (copy-on-write), for deep copy @see clone() 
         Bitmap& operator=(const Bitmap& other) = default;
         
         /// Move operator. 
@@ -338,6 +596,35 @@ namespace  Gempyre {
         /// Get a single pixel.
         Color::type pixel(int x, int y) const;
 
+        /// @brief Pixels of a row for direct access, faster than set_pixel() and pixel() in loops.
+        /// @param y - row, empty span if not in the bitmap.
+        /// @details As other writes, copies the pixels if they are shared with a copy of this bitmap, hence
+        /// use const_row() for reading. The span is valid until the bitmap is recreated, or copied and written.
+        [[nodiscard]] PixelSpan<Color::type> row(int y);
+
+        /// @brief Pixels of a row for reading, @see row()
+        /// @param y - row, empty span if not in the bitmap.
+        [[nodiscard]] PixelSpan<const Color::type> const_row(int y) const;
+
+        /// @brief All rows for direct access, @see row()
+        [[nodiscard]] PixelRows<Color::type> rows();
+
+        /// @brief All rows for reading, @see const_row()
+        [[nodiscard]] PixelRows<const Color::type> const_rows() const;
+
+        /// @brief Set pixels of a row to a color.
+        /// @param x - first pixel.
+        /// @param y - row.
+        /// @param count - number of pixels, clipped to the bitmap.
+        void fill_row(int x, int y, int count, Color::type color);
+
+        /// @brief Copy pixels into a row.
+        /// @param x - first pixel.
+        /// @param y - row.
+        /// @param pixels - pixels to copy.
+        /// @param count - number of pixels, clipped to the bitmap.
+        void copy_row(int x, int y, const Color::type* pixels, int count);
+
         /// Get width.
         [[nodiscard]] int width() const;
 
@@ -350,12 +637,65 @@ namespace  Gempyre {
         /// Draw a rect with a color in bitmap.
         void draw_rect(const Gempyre::Rect& rect, Color::type color);
 
+        /// @brief Draw an anti-aliased line.
+        /// @param from - start point.
+        /// @param to - end point.
+        /// @param color - line color, composited as BlendMode::SourceOver.
+        /// @param width - line width.
+        void draw_line(const Point& from, const Point& to, Color::type color, double width = 1.0);
+
+        /// @brief Draw anti-aliased connected lines, joints are round.
+        /// @details Overlapping parts are drawn once, so a translucent color stays even.
+        void draw_polyline(const std::vector<Point>& points, Color::type color, double width = 1.0);
+
+        /// @brief Fill an anti-aliased polygon, the last point connects to the first.
+        void fill_polygon(const std::vector<Point>& points, Color::type color, FillRule rule = FillRule::NonZero);
+
+        /// @brief Draw an anti-aliased ellipse outline.
+        /// @param centre - centre point.
+        /// @param rx - horizontal radius.
+        /// @param ry - vertical radius.
+        /// @param color - line color.
+        /// @param width - line width.
+        void draw_ellipse(const Point& centre, double rx, double ry, Color::type color, double width = 1.0);
+
+        /// @brief Fill an anti-aliased ellipse.
+        void fill_ellipse(const Point& centre, double rx, double ry, Color::type color);
+
+        /// @brief Draw an anti-aliased circle outline.
+        void draw_circle(const Point& centre, double r, Color::type color, double width = 1.0) {draw_ellipse(centre, r, r, color, width);}
+
+        /// @brief Fill an anti-aliased circle.
+        void fill_circle(const Point& centre, double r, Color::type color) {fill_ellipse(centre, r, r, color);}
+
         /// Draw a Bitmap on this bitmap - merge alpha.  
         void merge(int x, int y, const Bitmap& other);
 
         /// Draw a Bitmap on this bitmap - merge alpha.  
         void merge(const Bitmap& other) {merge(0, 0, other);}
 
+        /// Draw a view on this bitmap - merge alpha. View must not overlap this bitmap.
+        void merge(int x, int y, const BitmapView& other);
+
+        /// @brief Composite a Bitmap on this bitmap.
+        /// @param x - position.
+        /// @param y - position.
+        /// @param other - source bitmap.
+        /// @param mode - compositing operator.
+        /// @param premultiplied - true if both bitmaps are premultiplied, @see premultiply().
+        /// @details When many layers are composited, keep them premultiplied and unpremultiply only the result,
+        /// otherwise each blend converts the pixels back and forth.
+        void blend(int x, int y, const Bitmap& other, BlendMode mode, bool premultiplied = false);
+
+        /// Composite a view on this bitmap, @see blend(). View must not overlap this bitmap.
+        void blend(int x, int y, const BitmapView& other, BlendMode mode, bool premultiplied = false);
+
+        /// Multiply color components with alpha.
+        void premultiply();
+
+        /// Divide color components with alpha, reverse of premultiply().
+        void unpremultiply();
+
         /// Draw a Bitmap on this bitmap - replace area.  
         void tile(int x, int y, const Bitmap& other);
 
@@ -365,9 +705,26 @@ namespace  Gempyre {
         /// Draw a Bitmap withing extents on this bitmap - replace area.  
         void tile(int x, int y, const Bitmap& other, int other_x, int other_y, int width, int height);
 
-        /// Create a new bitmap from part of bitmap
+        /// Draw a view on this bitmap - replace area. View must not overlap this bitmap.
+        void tile(int x, int y, const BitmapView& other);
+
+        /// Create a new bitmap from part of bitmap, @see BitmapView to refer the part without a copy.
         Bitmap clip(const Gempyre::Rect& rect) const;
 
+        /// @brief Create a scaled copy.
+        /// @param width - new width.
+        /// @param height - new height.
+        /// @param filter - sampling.
+        /// @details E.g. thumbnails, or a bitmap of the device pixel ratio so that the browser does not scale it.
+        Bitmap scaled(int width, int height, Filter filter = Filter::Bilinear) const;
+
+        /// @brief Draw a transformed view on this bitmap - replace area.
+        /// @param other - source, must not overlap this bitmap.
+        /// @param transform - maps source coordinates into this bitmap.
+        /// @param filter - sampling, Box is same as Bilinear.
+        /// @details Pixels that the transformed source does not cover are not changed.
+        void transform(const BitmapView& other, const Transform& transform, Filter filter = Filter::Bilinear);
+
         /// return true if there is not data  
         bool empty() const;
 
@@ -393,8 +750,247 @@ namespace  Gempyre {
         std::size_t size() const;
         /// @endcond
     private:
+        void detach();
         friend class Gempyre::CanvasElement;
+        friend class Gempyre::VirtualCanvas;
+        friend class BitmapView;
+        friend class IndexedBitmap;
+        template<class Format> friend class PixelBitmap;
         Gempyre::CanvasDataPtr m_canvas{};
     };
 
+    /// @brief Non-owning view to pixels, either to a part of a Bitmap or to an external buffer.
+    /// @details Drawing a view copies the pixels directly from where they are, e.g. from a framebuffer of
+    /// the application. The view does not keep the pixels alive: the buffer or the Bitmap must outlive the view,
+    /// and a viewed Bitmap must not be recreated, nor written while its pixels are shared with a copy, as then
+    /// the write moves the pixels. 
+    /// @note
+    /// @code{.cpp}
+    /// std::vector<Gempyre::Color::type> frame(width * height);
+    /// simulate(frame);
+    /// canvas.draw(0, 0, Gempyre::BitmapView(frame.data(), width, height));
+    /// @endcode
+    class GEMPYRE_EX BitmapView {
+    public:
+        /// @brief Constructor - empty view.
+        BitmapView() = default;
+
+        /// @brief Constructor - view to a buffer.
+        /// @param pixels - pixels as @see Color::rgba()
+        /// @param width 
+        /// @param height 
+        /// @param stride - distance of rows in pixels, 0 if same as width.
+        BitmapView(const Color::type* pixels, int width, int height, int stride = 0);
+
+        /// @brief Constructor - view to a whole bitmap.
+        BitmapView(const Bitmap& bitmap);
+
+        /// @brief Constructor - view to a part of bitmap.
+        /// @param bitmap 
+        /// @param rect - area, clipped to the bitmap.
+        BitmapView(const Bitmap& bitmap, const Gempyre::Rect& rect);
+
+        /// Part of this view, clipped to this view.
+        [[nodiscard]] BitmapView view(const Gempyre::Rect& rect) const;
+
+        /// Get width.
+        [[nodiscard]] int width() const {return m_width;}
+
+        /// Get height.
+        [[nodiscard]] int height() const {return m_height;}
+
+        /// Distance of rows in pixels.
+        [[nodiscard]] int stride() const {return m_stride;}
+
+        /// return true if there is no pixels
+        [[nodiscard]] bool empty() const {return !m_pixels || m_width <= 0 || m_height <= 0;}
+
+        /// First pixel of a row.
+        [[nodiscard]] const Color::type* row(int y) const {return m_pixels + static_cast<std::ptrdiff_t>(y) * m_stride;}
+
+        /// Get a single pixel.
+        [[nodiscard]] Color::type pixel(int x, int y) const {return row(y)[x];}
+
+        /// All rows for reading.
+        [[nodiscard]] PixelRows<const Color::type> rows() const {return empty() ? PixelRows<const Color::type>{} : PixelRows<const Color::type>{m_pixels, m_width, m_height, m_stride};}
+
+        /// Deep copy into a bitmap.
+        [[nodiscard]] Bitmap to_bitmap() const;
+
+        /// Scaled copy into a bitmap, @see Bitmap::scaled()
+        [[nodiscard]] Bitmap scaled(int width, int height, Filter filter = Filter::Bilinear) const;
+
+    private:
+        const Color::type* m_pixels{nullptr};
+        int m_width{0};
+        int m_height{0};
+        int m_stride{0};
+    };
+
+    /// @brief 8-bit palette indexed bitmap.
+    /// @details Drawn on CanvasElement using one byte per pixel, and the palette is sent only when it has changed,
+    /// hence prefer this over Bitmap for palette based visualizations like heatmaps and fire effects.
+    /// Unlike Bitmap, copy of IndexedBitmap is a deep copy.
+    class GEMPYRE_EX IndexedBitmap {
+    public:
+        /// @brief Palette type.
+        using Palette = std::array<Color::type, 256>;
+
+        /// @brief Constructor - zero size, use @see create() to create the actual bitmap.
+        IndexedBitmap() = default;
+
+        /// @brief Constructor - all pixels are index 0.
+        /// @param width 
+        /// @param height 
+        IndexedBitmap(int width, int height);
+
+        /// @brief Constructor - with a palette.
+        /// @param width 
+        /// @param height 
+        /// @param palette 
+        IndexedBitmap(int width, int height, const Palette& palette);
+
+        /// @brief  Create bitmap bytes, all pixels are index 0.
+        /// @param width 
+        /// @param height 
+        void create(int width, int height);
+
+        /// Set a single pixel.
+        void set_index(int x, int y, uint8_t index) {m_data[static_cast<size_t>(x + y * m_width)] = index;}
+
+        /// Get a single pixel.
+        [[nodiscard]] uint8_t index(int x, int y) const {return m_data[static_cast<size_t>(x + y * m_width)];}
+
+        /// Get a single pixel color.
+        [[nodiscard]] Color::type pixel(int x, int y) const {return m_palette[index(x, y)];}
+
+        /// Set palette.
+        void set_palette(const Palette& palette) {m_palette = palette;}
+
+        /// Set a single palette color.
+        void set_color(uint8_t index, Color::type color) {m_palette[index] = color;}
+
+        /// Get palette.
+        [[nodiscard]] const Palette& palette() const {return m_palette;}
+
+        /// Get width.
+        [[nodiscard]] int width() const {return m_width;}
+
+        /// Get height.
+        [[nodiscard]] int height() const {return m_height;}
+
+        /// return true if there is not data  
+        [[nodiscard]] bool empty() const {return m_width <= 0 || m_height <= 0;}
+
+        /// Indices, width bytes per row.
+        [[nodiscard]] uint8_t* data() {return m_data.data();}
+
+        /// Indices, width bytes per row.
+        [[nodiscard]] const uint8_t* data() const {return m_data.data();}
+
+        /// Expand to a Bitmap using the palette.
+        [[nodiscard]] Bitmap to_bitmap() const;
+
+    private:
+        std::vector<uint8_t> m_data{};
+        Palette m_palette{};
+        int m_width{0};
+        int m_height{0};
+    };
+
+    /// @brief Bitmap in a compact or foreign pixel format, converted to and from RGBA in bulk.
+    /// @details Conversions are vectorized, hence use this instead of converting pixel by pixel, e.g. for
+    /// grayscale sensor data or BGRA frames of a capture library. A GrayBitmap is drawn on a CanvasElement
+    /// using one byte per pixel, the other formats are drawn as RGBA.
+    /// Unlike Bitmap, copy of PixelBitmap is a deep copy.
+    /// @note
+    /// @code{.cpp}
+    /// Gempyre::GrayBitmap frame(width, height);
+    /// sensor.read(frame.data());
+    /// canvas.draw(0, 0, frame);
+    /// @endcode
+    template<class Format>
+    class PixelBitmap {
+    public:
+        /// @brief Pixel type, @see PixelFormat
+        using value_type = typename Format::value_type;
+
+        /// @brief Constructor - zero size, use @see create() to create the actual bitmap.
+        PixelBitmap() = default;
+
+        /// @brief Constructor - all pixels are zero.
+        /// @param width 
+        /// @param height 
+        PixelBitmap(int width, int height) {
+            if(width > 0 && height > 0)
+                create(width, height);
+        }
+
+        /// @brief Constructor - converted from RGBA pixels.
+        /// @param view - pixels to convert, e.g. a Bitmap.
+        explicit PixelBitmap(const BitmapView& view) {assign(view);}
+
+        /// @brief Create bitmap, all pixels are zero.
+        /// @param width 
+        /// @param height 
+        void create(int width, int height) {
+            m_data.assign(static_cast<size_t>(std::max(width, 0)) * static_cast<size_t>(std::max(height, 0)), 0);
+            m_width = width;
+            m_height = height;
+        }
+
+        /// @brief Convert from RGBA pixels, the size changes as the view's.
+        /// @param view - pixels to convert, e.g. a Bitmap.
+        void assign(const BitmapView& view);
+
+        /// Set a single pixel.
+        void set_pixel(int x, int y, value_type value) {m_data[static_cast<size_t>(x + y * m_width)] = value;}
+
+        /// Get a single pixel.
+        [[nodiscard]] value_type pixel(int x, int y) const {return m_data[static_cast<size_t>(x + y * m_width)];}
+
+        /// Get width.
+        [[nodiscard]] int width() const {return m_width;}
+
+        /// Get height.
+        [[nodiscard]] int height() const {return m_height;}
+
+        /// return true if there is not data  
+        [[nodiscard]] bool empty() const {return m_width <= 0 || m_height <= 0;}
+
+        /// Pixels, width pixels per row.
+        [[nodiscard]] value_type* data() {return m_data.data();}
+
+        /// Pixels, width pixels per row.
+        [[nodiscard]] const value_type* data() const {return m_data.data();}
+
+        /// Convert to an RGBA Bitmap.
+        [[nodiscard]] Bitmap to_bitmap() const {return to_bitmap(m_data.data(), m_width, m_height);}
+
+        /// @brief Convert pixels of this format to an RGBA Bitmap, without copying them into a PixelBitmap.
+        /// @param pixels - e.g. a frame of a capture library.
+        /// @param width 
+        /// @param height 
+        /// @param stride - distance of rows in pixels, 0 if same as width.
+        [[nodiscard]] static Bitmap to_bitmap(const value_type* pixels, int width, int height, int stride = 0);
+
+    private:
+        std::vector<value_type> m_data{};
+        int m_width{0};
+        int m_height{0};
+    };
+
+    /// @cond INTERNAL
+    extern template class GEMPYRE_EX PixelBitmap<PixelFormat::Gray8>;
+    extern template class GEMPYRE_EX PixelBitmap<PixelFormat::RGB565>;
+    extern template class GEMPYRE_EX PixelBitmap<PixelFormat::BGRA>;
+    /// @endcond
+
+    /// 8-bit grayscale bitmap.
+    using GrayBitmap = PixelBitmap<PixelFormat::Gray8>;
+    /// 16-bit RGB565 bitmap.
+    using Rgb565Bitmap = PixelBitmap<PixelFormat::RGB565>;
+    /// 32-bit BGRA bitmap.
+    using BgraBitmap = PixelBitmap<PixelFormat::BGRA>;
+
 }
\ No newline at end of file
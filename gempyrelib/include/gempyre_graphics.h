@@ -7,6 +7,9 @@
 #include <string_view>
 #include <functional>
 #include <vector>
+#include <optional>
+#include <chrono>
+#include <string>
 
 #include <gempyre.h>
 #include <gempyre_bitmap.h> // for compatibility, not really needed, fwd declaration is sufficient
@@ -34,7 +37,11 @@ namespace  Gempyre {
 /// @brief 
 class FrameComposer;
 class CanvasData;
+struct CanvasState;
+struct VirtualCanvasState;
 class Bitmap;
+class BitmapView;
+class IndexedBitmap;
 using CanvasDataPtr = std::shared_ptr<CanvasData>;
 
 /// @brief Graphics element
@@ -49,6 +56,44 @@ public:
     
     /// set initial draw, @see CanvasElement::draw_completed()
     enum class DrawNotify{NoKick, Kick};
+
+    /// @brief Function type for frame requests. @see CanvasElement::on_frame
+    using FrameCallback = std::function<void()>;
+
+    /// @brief Compression of bitmap data sent to the UI, @see CanvasElement::set_compression()
+    enum class Compression {
+        None,       ///< Uncompressed, fastest when UI is local.
+        Rle,        ///< Run-length encoding, fast and good for flat colors.
+        Deflate,    ///< Deflate, smaller but slower.
+        Adaptive,   ///< Select per tile what pays off.
+        Jpeg        ///< Lossy, for photographic and video content, @see CanvasElement::set_quality().
+    };
+
+    /// @brief Steps the adaptive quality takes when the UI cannot keep up, @see CanvasElement::set_adaptive_quality()
+    enum class QualityLevel {
+        Full,           ///< As set.
+        Compressed,     ///< Uncompressed bitmaps are compressed.
+        Lossy,          ///< Bitmaps are compressed lossy.
+        HalfResolution, ///< Lossy bitmaps are sent in half resolution and scaled up in the UI.
+        SkipFrames      ///< As above and every other draw is skipped.
+    };
+
+    /// @brief Adaptive quality state and what it is based on.
+    struct QualityState {
+        QualityLevel level;                     ///< Current level.
+        Compression compression;                ///< Compression in use.
+        int scale;                              ///< Resolution divisor, 1 is full.
+        bool skip_frames;                       ///< Draws are skipped.
+        size_t queued_bytes;                    ///< Data waiting to be sent.
+        std::chrono::milliseconds latency;      ///< How long the latest data waited to be sent.
+        std::chrono::milliseconds frame_latency;///< From the draw to its acknowledge, when paced with on_frame.
+        unsigned backpressure;                  ///< How many times the connection was congested, cumulative.
+        unsigned drops;                         ///< How many times data was dropped, cumulative.
+        std::string reason;                     ///< Why the level was changed.
+    };
+
+    /// @brief Function type for quality changes. @see CanvasElement::set_adaptive_quality
+    using QualityCallback = std::function<void(const QualityState&)>;
     
     /// Destructor.
     ~CanvasElement();
@@ -86,6 +131,18 @@ public:
     /// @param loaded callback called when image is loaded.
     /// @return image id.
     std::string add_image(std::string_view url, const std::function<void (std::string_view id)>& loaded = nullptr);
+
+    /// @brief Add an image from a bitmap.
+    /// @param bitmap image content.
+    /// @param loaded callback called when image is loaded.
+    /// @return image id to use with paint_image and FrameComposer::draw_image.
+    /// @details The bitmap is sent once and kept in the UI, hence drawing it does not cost any bandwidth, i.e.
+    /// good for sprites and backgrounds. The image is usable with any canvas, but it is lost if the UI is reloaded.
+    std::string add_image(const Bitmap& bitmap, const std::function<void (std::string_view id)>& loaded = nullptr);
+
+    /// @brief Remove an image added with add_image.
+    /// @param imageId image id.
+    void remove_image(std::string_view imageId);
     
     /// @brief Draw image at position.
     /// @param imageId image id.
@@ -118,29 +175,158 @@ public:
     /// @param x 
     /// @param y 
     /// @param bmp 
+    /// @details Bitmap is sent in tiles, and only tiles that have changed since the previous draw
+    /// at the same position are sent. Canvas commands, images and erase resets that bookkeeping.
+    /// If the draw waits for the client (@see on_frame()), it shares the pixels with bmp, so
+    /// the application can continue drawing on bmp, and only then its pixels are copied.
     void draw(int x, int y, const Bitmap& bmp); 
 
+    /// @brief Draw pixels of a view at position
+    /// @param x 
+    /// @param y 
+    /// @param view - e.g. a part of a bitmap or a framebuffer of the application.
+    /// @details As draw of a Bitmap, but the pixels are read directly from the viewed memory, hence a framebuffer
+    /// is drawn without copying it into a Bitmap. The memory can be reused when this returns.
+    void draw(int x, int y, const BitmapView& view);
+
+    /// @brief Draw indexed bitmap
+    /// @param bmp 
+    void draw(const IndexedBitmap& bmp) {draw(0, 0, bmp);}
+
+    /// @brief Draw indexed bitmap at position
+    /// @param x 
+    /// @param y 
+    /// @param bmp 
+    /// @details Pixels are sent as 8-bit indices and expanded in the UI, the palette is sent only when it has changed.
+    void draw(int x, int y, const IndexedBitmap& bmp);
+
+    /// @brief Draw grayscale bitmap at position
+    /// @param x 
+    /// @param y 
+    /// @param bmp 
+    /// @details Pixels are sent as one byte per pixel and expanded in the UI, as an indexed bitmap with a gray palette.
+    void draw(int x, int y, const GrayBitmap& bmp);
+
+    /// @brief Draw bitmap of other pixel format at position
+    /// @param x 
+    /// @param y 
+    /// @param bmp 
+    /// @details Pixels are converted to RGBA and drawn as a Bitmap.
+    template<class Format>
+    void draw(int x, int y, const PixelBitmap<Format>& bmp) {draw(x, y, bmp.to_bitmap());}
+
     /// @brief Set a callback to be called after the draw
     /// @param drawCompletedCallback - function called after draw.
     /// @param kick - optional whether callback is called 1st time automatically.
     /// @details - When doing animation or frequent drawing, please do no call draw functions inside timer function.
     /// The preferred way is to to do animation in timer function, but use draw_completed to do the actual drawing. 
     /// draw_completed do drawing in the optimal frequency (as fast the system can do it without consuming all CPU).
+    /// For bitmap animation @see on_frame is preferred.
     /// @note
     /// @code{.cpp}
     /// canvas_element.draw_completed([this]() {draw_frame();}, Gempyre::CanvasElement::DrawNotify::Kick);
     /// ui.start_periodic(50ms, [this]() {animate();});
     /// @endcode
     void draw_completed(const DrawCallback& drawCompletedCallback, DrawNotify kick = DrawNotify::NoKick);
+
+    /// @brief Let the UI pace the bitmap drawing.
+    /// @param frameCallback - function called when the UI is ready for a next frame, nullptr stops pacing.
+    /// @details The UI presents drawn bitmaps in its animation frame and acknowledges them. While the UI is busy,
+    /// a bitmap drawn on this canvas waits and a newer draw at the same position replaces it, so a producer faster
+    /// than the display does not build up latency. Bitmaps drawn inside the callback are a single frame.
+    /// The callback is called soon after set and then whenever the UI has presented the frame.
+    /// @note
+    /// @code{.cpp}
+    /// canvas_element.on_frame([this]() {canvas_element.draw(bitmap);});
+    /// @endcode
+    void on_frame(const FrameCallback& frameCallback);
     
+    /// @brief Set compression of bitmaps drawn on this canvas.
+    /// @param compression - compression method, default is None.
+    /// @details When UI is not on the localhost, bandwidth is likely the bottleneck and compression pays off.
+    /// The setting is shared between copies of this CanvasElement.
+    void set_compression(Compression compression);
+
+    /// @brief Set quality of lossy compression.
+    /// @param quality - 1 - 100, default is 75.
+    /// @details Lossy tiles are not sent as deltas, and indexed bitmaps are always compressed losslessly.
+    void set_quality(int quality);
+
+    /// @brief Let the quality of bitmaps adapt to what the connection and the UI can take.
+    /// @param enable - true to enable, default is false.
+    /// @param on_change - optional function called when the level changes.
+    /// @details The send queue, its latency, congestion, dropped data and, when paced with on_frame,
+    /// frame acknowledges are observed. Under pressure the quality is lowered one level at a time,
+    /// @see QualityLevel, and restored one level at a time when it has been calm for a while.
+    /// Indexed bitmaps are compressed, but not sent lossy nor in a lower resolution.
+    void set_adaptive_quality(bool enable, const QualityCallback& on_change = nullptr);
+
+    /// @brief Get the adaptive quality state.
+    /// @return current state, Full level if adaptive quality is not enabled.
+    QualityState quality_state() const;
+
+    /// @brief Present each bitmap draw as a whole.
+    /// @param atomic - true to enable, default is false.
+    /// @details A big bitmap is sent in several parts. By default the UI puts each part as it comes, and on a congested
+    /// connection some parts may be dropped, hence the canvas may show a mix of old and new content. When atomic, the UI
+    /// collects the parts and puts them only when the draw is complete, and when the connection is congested the whole
+    /// draw is dropped. A dropped draw is noticed and all of the next draw is sent.
+    void set_atomic(bool atomic);
+
+    /// @brief Send bitmap tiles as differences to the previously sent content.
+    /// @param delta - true to enable, default is false.
+    /// @details Tile that has changed is sent as XOR against its previous content, that is mostly zero when
+    /// only part of the tile has changed and compresses well. Good for animations where tile skipping is not enough.
+    /// A full tile is sent when the UI may have missed data, i.e. after a reconnect or when data is dropped.
+    void set_delta(bool delta);
+
+    /// @brief Send big bitmaps coarse first, then refine.
+    /// @param progressive - true to enable, default is false.
+    /// @details When a draw changes a large area, a preview of 1/8 resolution is sent first and the UI shows it upscaled.
+    /// Full resolution tiles follow in small messages, from the centre of the changed area outward.
+    /// Not applied to atomic draws, to indexed bitmaps or when the adaptive quality has lowered the resolution.
+    void set_progressive(bool progressive);
+
+    /// @brief Copy a rectangle of the canvas within the canvas.
+    /// @param source - rectangle to copy.
+    /// @param x - target x coordinate.
+    /// @param y - target y coordinate.
+    /// @details The copy is done in the UI, no pixels are sent. Source and target may overlap, hence this
+    /// scrolls the content and only the exposed area is needed to draw.
+    /// @note
+    /// @code{.cpp}
+    /// canvas_element.blit({0, 1, width, height - 1}, 0, 0); // scroll up by one row
+    /// canvas_element.draw(0, height - 1, new_row);
+    /// @endcode
+    void blit(const Element::Rect& source, int x, int y);
+
+    /// @brief Read pixels of the canvas.
+    /// @param rect - area to read, default is the whole canvas.
+    /// @return bitmap of the area that is within the canvas, std::nullopt if the read fails.
+    /// @details The UI sends the pixels in tiles over the binary channel, hence a big canvas does not need a huge message.
+    /// Like queries, this waits for the UI. Good for tests and to export what is shown.
+    std::optional<Bitmap> read_bitmap(const Element::Rect& rect = {0, 0, 0, 0});
+
     /// @brief erase bitmap
     /// @param resized - make an explicit query to ask canvas current size
     void erase(bool resized = false);
 private:
     friend class Bitmap;
-    void paint(const CanvasDataPtr& canvas, int x, int y, bool as_draw);
+    void paint(const BitmapView& bitmap, int x, int y, bool as_draw);
+    void paint(const uint8_t* indices, int width, int height, const IndexedBitmap::Palette& palette, int x, int y, bool as_draw);
+    void prepare_paint();
+    void send_tiles(dataT type, const std::vector<dataT>& prefix, int x, int y, bool as_draw);
+    void make_deltas();
+    void send_preview(const BitmapView& bitmap, int x, int y);
+    void invalidate_tiles() const;
+    bool hold(int x, int y, const BitmapView* bitmap, const IndexedBitmap* indexed, const CanvasDataPtr& pixels = {});
+    void frame_presented(unsigned frames);
+    bool send_held();
+    void next_frame();
+    void adapt_quality();
+    bool skip_draw(int x, int y, bool as_draw);
 private:
-    CanvasDataPtr m_tile{};
+    std::shared_ptr<CanvasState> m_state{};
     int m_width{0};
     int m_height{0};
 };
@@ -243,6 +429,51 @@ private:
 };
 
 
+/// @brief Scrollable canvas of a size that is not limited by the memory or by the browser.
+/// @details The content is asked from a tile provider only for the tiles that are visible in the UI,
+/// and the UI forgets the tiles that are scrolled far enough.
+/// @note
+/// @code{.cpp}
+/// Gempyre::VirtualCanvas map(ui, ui.root(), 50000, 50000);
+/// map.set_style("height", "100vh");
+/// map.set_tile_provider([](const Gempyre::Element::Rect& area, Gempyre::Bitmap& tile) {
+///     tile.draw_rect({0, 0, area.width, area.height}, color_at(area.x, area.y));
+/// });
+/// @endcode
+class GEMPYRE_EX VirtualCanvas : public Element {
+public:
+    /// @brief Default tile size.
+    static constexpr int DefaultTileSize = 256;
+    /// @brief Function type that draws an area of the canvas into a bitmap of the area size.
+    using TileProvider = std::function<void(const Element::Rect& area, Bitmap& bitmap)>;
+    /// @brief Constructor, creates a scrollable element.
+    /// @param ui - Ui.
+    /// @param parent - parent element.
+    /// @param width - logical width of the canvas in pixels.
+    /// @param height - logical height of the canvas in pixels.
+    /// @param tile_size - width and height of tiles the canvas is streamed in.
+    VirtualCanvas(Ui& ui, const Element& parent, int width, int height, int tile_size = DefaultTileSize);
+    /// @brief Destructor.
+    ~VirtualCanvas();
+    /// @brief Set function that provides the canvas content.
+    /// @details The provider is called in the event thread, when a tile becomes visible.
+    void set_tile_provider(const TileProvider& provider);
+    /// @brief Content of an area has changed, visible tiles are asked again and the rest when they become visible.
+    void invalidate(const Element::Rect& area);
+    /// @brief Set compression of tiles, @see CanvasElement::set_compression()
+    void set_compression(CanvasElement::Compression compression);
+    /// @brief Area that is visible in the UI, empty until the UI has reported it.
+    [[nodiscard]] Element::Rect viewport() const;
+    /// @brief Logical width.
+    [[nodiscard]] int width() const;
+    /// @brief Logical height.
+    [[nodiscard]] int height() const;
+private:
+    void update();
+private:
+    std::shared_ptr<VirtualCanvasState> m_state{};
+};
+
 }
 
 #endif // GEMPYRE_GRAPHICS_H
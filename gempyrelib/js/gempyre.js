@@ -320,6 +320,9 @@ function serveQuery(element, query_id, query, query_params) {
                'query_value': 'bounding_rect',
                'bounding_rect': {'x':r.left, 'y':r.top, 'width': r.right - r.left, 'height': r.bottom - r.top}}));
            break;
+        case 'image_data':
+            sendImageData(el, query_id, query_params);
+            break;
         case 'devicePixelRatio':
             socket.send(JSON.stringify({
                                            'type': 'query',
@@ -333,6 +336,37 @@ function serveQuery(element, query_id, query, query_params) {
     }
 }
 
+// canvas pixels are sent as binary tiles, and then the reply tells how many there are and the actual rect
+function sendImageData(el, query_id, params) {
+    const ctx = el.getContext ? el.getContext("2d") : null;
+    if(!ctx) {
+        errlog(el.id, "has no graphics context");
+        socket.send(JSON.stringify({'type': 'query', 'query_id': query_id, 'query_value':'query_error', 'query_error':'query_error'}));
+        return;
+    }
+    if(framesToPresent.has(el.id))
+        presentFrame(el.id); // what is drawn is read
+    const [read_id, rx, ry, rw, rh] = params.map(Number);
+    const x = Math.max(0, rx);
+    const y = Math.max(0, ry);
+    const w = Math.max(0, Math.min(rw > 0 ? rx + rw : el.width, el.width) - x);
+    const h = Math.max(0, Math.min(rh > 0 ? ry + rh : el.height, el.height) - y);
+    let index = 0;
+    for(let j = 0; j < h; j += ReadTileSize) {
+        for(let i = 0; i < w; i += ReadTileSize) {
+            const tw = Math.min(ReadTileSize, w - i);
+            const th = Math.min(ReadTileSize, h - j);
+            const image = ctx.getImageData(x + i, y + j, tw, th);
+            const message = new Uint32Array(7 + tw * th);
+            message.set([(ProtocolVersion << 16) | CanvasReadId, read_id, index++, i, j, tw, th]);
+            new Uint8ClampedArray(message.buffer, 7 * 4).set(image.data);
+            socket.send(message.buffer);
+        }
+    }
+    socket.send(JSON.stringify({'type': 'query', 'query_id': query_id, 'query_value': 'image_data',
+        'image_data': [String(index), String(x), String(y), String(w), String(h)]}));
+}
+
 function observeRemove(element) {
     if (!element.parentNode) {
         console.error("Cannot observe: element has no parent node", element.id);
@@ -372,73 +406,601 @@ function sendCollection(name, query_id, query, collectionFunction) {
     socket.send(JSON.stringify({'type': 'query', 'query_id': query_id, 'query_value': 'children', 'children': children}));   
 }
 
+const ProtocolVersion = 1;      // binary type word: version << 16 | type, version 1 header starts with a canvas handle
+const CanvasId = 0xAAA;         // a single tile
+const CanvasFrameId = 0xAAB;    // tile records of a frame: (x, y, w, h, codec, bytes, payload<bytes, padded to 4>)*
+const CanvasIndexedFrameId = 0xAAC; // palette (size, colors<size>) and tile records of 8-bit indices
+const ImageBitmapId = 0xAAD;    // a tile record of an image, image name is the owner id
+const CanvasReadId = 0xAAE;     // to server: read id, tile index, x, y, w, h, RGBA bytes
+const VirtualTilesId = 0xAAF;   // tile records of a virtual canvas, positions in canvas coordinates
+const CanvasBlitId = 0xAB0;     // header rect is copied to x, y in data, in order with the tiles
+const ReadTileSize = 512;       // canvas is read in tiles, that each is a message
+const TileRecordHeader = 6;
+const CodecRaw = 0;
+const CodecRle = 1;
+const CodecDeflate = 2;
+const CodecJpeg = 3;
+
+function putTile(ctx, buffer, offset, x, y, w, h, datalen) {
+    if(w > 0 && h > 0) {
+        const bytesLen = w * h * 4;
+        const data = new Uint8ClampedArray(buffer, offset, Math.min(bytesLen, datalen));
+        ctx.putImageData(new ImageData(data, w, h), x, y);
+    }
+}
+
+// token with high bit set is a run: count, value, otherwise count literals follows
+function rleDecode(src, pixels) {
+    let s = 0;
+    let d = 0;
+    while(s < src.length && d < pixels.length) {
+        const token = src[s++];
+        const count = token & 0x7FFFFFFF;
+        if(token & 0x80000000) {
+            pixels.fill(src[s++], d, d + count);
+        } else {
+            pixels.set(src.subarray(s, s + count), d);
+            s += count;
+        }
+        d += count;
+    }
+}
+
+function inflate(bytes) {
+    const stream = new Blob([bytes]).stream().pipeThrough(new DecompressionStream('deflate'));
+    return new Response(stream).arrayBuffer();
+}
+
+// canvas id -> palette, for indexed frames
+const palettes = new Map();
+
+const DeltaKeyframe = 0x10; // codec flag: tile is a reference for following deltas
+const DeltaXor = 0x20;      // codec flag: tile is XOR against its reference
+const DeltaHeader = 2;      // base serial, serial
+
+// canvas id -> Map(tile key -> {rect, serial, words}), last content of tiles for deltas
+const tileReferences = new Map();
+
+function intersects(a, b) {
+    return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+// returns reconstructed payload and keeps it as a reference, null if it cannot be reconstructed
+function applyDelta(refs, tile, payload) {
+    const key = tile.x + ',' + tile.y + ',' + tile.w + ',' + tile.h;
+    const words = new Uint32Array((payload.length + 3) >> 2);
+    new Uint8Array(words.buffer).set(payload);
+    if(tile.flags & DeltaXor) {
+        const ref = refs.get(key);
+        if(!ref || ref.serial !== tile.base || ref.words.length !== words.length) {
+            log("Delta reference missing", key, tile.base);  // server sends a keyframe after drop
+            refs.delete(key);
+            return null;
+        }
+        for(let i = 0; i < words.length; i++)
+            words[i] ^= ref.words[i];
+    }
+    if(!refs.has(key)) {
+        for(const [k, ref] of refs) {
+            if(intersects(ref.rect, tile))
+                refs.delete(k);
+        }
+    }
+    refs.set(key, {'rect': {'x': tile.x, 'y': tile.y, 'w': tile.w, 'h': tile.h}, 'serial': tile.serial, 'words': words});
+    return new Uint8Array(words.buffer, 0, payload.length);
+}
+
+// payload as RGBA bytes, or if palette is given, indices are expanded
+function toPixels(payload, w, h, palette) {
+    if(!palette)
+        return new Uint8ClampedArray(payload.buffer, payload.byteOffset, w * h * 4);
+    const pixels = new Uint32Array(w * h);
+    for(let i = 0; i < pixels.length; i++)
+        pixels[i] = palette[payload[i]];
+    return new Uint8ClampedArray(pixels.buffer);
+}
+
+// decode tile records, returns a promise if any of them is decoded asynchronously
+function decodeFrame(buffer, bytes, pos, end, palette, refs) {
+    const tiles = [];
+    let pending = false;
+    while(pos + TileRecordHeader <= end) {
+        const w = bytes[pos + 2];
+        const h = bytes[pos + 3];
+        const codec = bytes[pos + 4] & 0xF;
+        const flags = bytes[pos + 4] & (DeltaKeyframe | DeltaXor);
+        const len = bytes[pos + 5];
+        const headerLen = TileRecordHeader + (flags ? DeltaHeader : 0);
+        const offset = (pos + headerLen) * 4;
+        const size = palette ? w * h : w * h * 4;
+        let payload = null;
+        if(codec === CodecRaw) {
+            payload = new Uint8Array(buffer, offset, size);
+        } else if(codec === CodecRle) {
+            const out = new Uint32Array((size + 3) >> 2);
+            rleDecode(new Uint32Array(buffer, offset, (len + 3) >> 2), out);
+            payload = new Uint8Array(out.buffer, 0, size);
+        } else if(codec === CodecDeflate) {
+            payload = inflate(new Uint8Array(buffer, offset, len)).then(data => new Uint8Array(data));
+            pending = true;
+        } else if(codec === CodecJpeg) {
+            payload = createImageBitmap(new Blob([new Uint8Array(buffer, offset, len)], {'type': 'image/jpeg'}));
+            pending = true;
+        } else {
+            errlog("Binary", "Unknown codec", codec);
+        }
+        if(payload) {
+            const tile = {'x': bytes[pos], 'y': bytes[pos + 1], 'w': w, 'h': h, 'pixels': payload, 'flags': flags, 'codec': codec};
+            if(flags) {
+                tile.base = bytes[pos + TileRecordHeader];
+                tile.serial = bytes[pos + TileRecordHeader + 1];
+            }
+            tiles.push(tile);
+        }
+        pos += headerLen + ((len + 3) >> 2);
+    }
+    // deltas are applied in order, after all tiles are decoded
+    const expand = decoded => {
+        const out = [];
+        decoded.forEach((payload, i) => {
+            const tile = tiles[i];
+            if(tile.codec === CodecJpeg) { // decoded by the browser, drawn as is
+                tile.bitmap = payload;
+                out.push(tile);
+                return;
+            }
+            if(tile.flags)
+                payload = applyDelta(refs, tile, payload);
+            if(payload) {
+                tile.pixels = toPixels(payload, tile.w, tile.h, palette);
+                out.push(tile);
+            }
+        });
+        return out;
+    };
+    if(!pending)
+        return expand(tiles.map(tile => tile.pixels));
+    return Promise.all(tiles.map(tile => tile.pixels)).then(expand);
+}
+
+// tiles sent in a lower resolution are put here and then scaled up onto the canvas
+let scaleCanvas = null;
+
+function putScaledTile(ctx, tile) {
+    if(!scaleCanvas)
+        scaleCanvas = document.createElement('canvas');
+    if(scaleCanvas.width < tile.w || scaleCanvas.height < tile.h) {
+        scaleCanvas.width = Math.max(scaleCanvas.width, tile.w);
+        scaleCanvas.height = Math.max(scaleCanvas.height, tile.h);
+    }
+    scaleCanvas.getContext("2d").putImageData(new ImageData(tile.pixels, tile.w, tile.h), 0, 0);
+    ctx.drawImage(scaleCanvas, 0, 0, tile.w, tile.h, tile.x * tile.scale, tile.y * tile.scale, tile.w * tile.scale, tile.h * tile.scale);
+}
+
+function putTiles(ctx, tiles) {
+    for(const tile of tiles) {
+        const scale = tile.scale || 1;
+        if(tile.bitmap)
+            ctx.drawImage(tile.bitmap, tile.x * scale, tile.y * scale, tile.w * scale, tile.h * scale);
+        else if(tile.w > 0 && tile.h > 0 && scale > 1)
+            putScaledTile(ctx, tile);
+        else if(tile.w > 0 && tile.h > 0)
+            ctx.putImageData(new ImageData(tile.pixels, tile.w, tile.h), tile.x, tile.y);
+    }
+}
+
+const DrawFlag = 0x1;   // frame header: draw ends here
+const PacedFlag = 0x2;  // frame header: present in animation frame and acknowledge draws
+const ScaleShift = 8;   // frame header: bits 8 - 15 are resolution divisor of tiles, 0 is same as 1
+const AtomicFlag = 0x4; // frame header: part of a draw that is presented as a whole, part index in bits 16 - 31
+const CommitFlag = 0x8; // frame header: atomic draw is complete, part count in bits 16 - 31
+const PartShift = 16;
+
+// parts of atomic draws are collected here until committed, canvas id -> {ctx, tiles, parts}
+const backBuffers = new Map();
+
+// returns tiles of the committed draw, null if the draw is not yet complete or some of its parts are dropped
+function assembleFrame(id, ctx, tiles, flags) {
+    const part = flags >>> PartShift;
+    let back = backBuffers.get(id);
+    if(!(flags & CommitFlag)) {
+        if(part === 0 || !back) {
+            back = {'ctx': null, 'tiles': [], 'parts': 0};
+            backBuffers.set(id, back);
+        }
+        back.parts = back.parts === part ? part + 1 : -1; // -1: a part is missing
+        if(ctx)
+            back.ctx = ctx;
+        for(const tile of tiles)
+            back.tiles.push(tile);
+        return null;
+    }
+    backBuffers.delete(id);
+    if(part === 0)
+        return {'ctx': null, 'tiles': []};
+    if(!back || back.parts !== part) {
+        log("Incomplete canvas frame dropped", id); // server resends after a drop
+        return null;
+    }
+    return back;
+}
+
+// paced frames wait here for an animation frame, canvas id -> {tiles, draws}
+const framesToPresent = new Map();
+let presentRequested = false;
+
+function queueFrame(id, ctx, tiles, flags) {
+    let frame = framesToPresent.get(id);
+    if(!frame) {
+        frame = {'ctx': ctx, 'tiles': [], 'draws': 0};
+        framesToPresent.set(id, frame);
+    }
+    if(ctx)
+        frame.ctx = ctx;
+    for(const tile of tiles) {
+        // latest tile at the same place wins, it is moved last to keep the drawing order
+        const index = frame.tiles.findIndex(t => t.x === tile.x && t.y === tile.y && t.w === tile.w && t.h === tile.h && t.scale === tile.scale);
+        if(index >= 0)
+            frame.tiles.splice(index, 1);
+        frame.tiles.push(tile);
+    }
+    if(flags & DrawFlag)
+        ++frame.draws;
+    if(!presentRequested) {
+        presentRequested = true;
+        requestAnimationFrame(presentFrames);
+    }
+}
+
+function presentFrame(id) {
+    const frame = framesToPresent.get(id);
+    framesToPresent.delete(id);
+    if(frame.ctx)
+        putTiles(frame.ctx, frame.tiles);
+    if(frame.draws > 0) {
+        notifyDraw(id);
+        socket.send(JSON.stringify({'type': 'event', 'element': id, 'event': 'canvas_frame',
+            'properties': {'frames': String(frame.draws)}}));
+    }
+}
+
+function presentFrames() {
+    presentRequested = false;
+    for(const id of Array.from(framesToPresent.keys()))
+        presentFrame(id);
+}
+
+function notifyDraw(id) {
+    // if there is a notification request - send a notify
+    if (event_notifiers.has("canvas_draw")) {
+        socket.send(JSON.stringify({
+                                        'type': 'event',
+                                        'element': id,
+                                        'event': 'event_notify',
+                                        'properties':{
+                                            'name': "canvas_draw",
+                                            'msgid': 0
+                                        }
+                                    }));
+        
+    }
+}
+
+// images uploaded as bitmaps, name -> ImageBitmap
+const imageBitmaps = new Map();
+
+// image added either as a bitmap or as an img element
+function findImage(name) {
+    return imageBitmaps.get(name) || document.getElementById(name);
+}
+
+// decoded image replaces an image of the same name, canvas is notified if requested
+function loadImage(name, canvasId, buffer, bytes, end, flags) {
+    return Promise.resolve(decodeFrame(buffer, bytes, 4, end, null, null)).then(tiles => {
+        if(tiles.length !== 1) {
+            errlog(name, "Invalid image");
+            return null;
+        }
+        const tile = tiles[0];
+        return tile.bitmap ? tile.bitmap : createImageBitmap(new ImageData(tile.pixels, tile.w, tile.h));
+    }).then(bitmap => {
+        if(!bitmap)
+            return;
+        const old = imageBitmaps.get(name);
+        if(old)
+            old.close();
+        imageBitmaps.set(name, bitmap);
+        if(flags & DrawFlag)
+            socket.send(JSON.stringify({'type': 'event', 'element': canvasId, 'event': 'image_loaded',
+                'properties': {'image': name}}));
+    });
+}
+
+function removeImage(name) {
+    const bitmap = imageBitmaps.get(name);
+    if(bitmap) {
+        bitmap.close();
+        imageBitmaps.delete(name);
+        return;
+    }
+    const image = document.getElementById(name);
+    if(image)
+        image.remove();
+}
+
+// owner id of a binary message
+function ownerId(buffer, bytes) {
+    const idOffset = (bytes[3] * 4) + (4 * 4) + (bytes[1] * 4);
+    const words = new Uint16Array(buffer, idOffset, bytes[2]);
+    let id = "";
+    for(let i = 0 ; i < words.length && words[i] > 0; i++)
+        id += String.fromCharCode(words[i]);
+    return id;
+}
+
+// canvas handle -> {id, element, ctx}, the server registers each canvas before it refers it by handle
+const canvasHandles = new Map();
+
+function registerCanvas(el, handle) {
+    canvasHandles.set(handle, {'id': el.id, 'element': el, 'ctx': null});
+}
+
+// virtual canvas handle -> state, tiles are kept only near the viewport
+const virtualCanvases = new Map();
+
+// scrollable element has a spacer of the logical size, and a canvas of the viewport size that follows the scroll
+function createVirtualCanvas(el, handle, width, height, tileSize) {
+    el.replaceChildren();
+    const spacer = document.createElement('div');
+    spacer.style.width = width + 'px';
+    spacer.style.height = height + 'px';
+    const canvas = document.createElement('canvas');
+    canvas.style.position = 'absolute';
+    canvas.style.left = '0px';
+    canvas.style.top = '0px';
+    el.appendChild(spacer);
+    el.appendChild(canvas);
+    const vc = {'id': el.id, 'element': el, 'canvas': canvas, 'ctx': canvas.getContext('2d'), 'tileSize': tileSize,
+        'tiles': new Map(), 'viewport': {'x': 0, 'y': 0, 'w': 0, 'h': 0}, 'pending': false};
+    const old = virtualCanvases.get(handle);
+    if(old)
+        evictTiles(old, null);
+    virtualCanvases.set(handle, vc);
+    const request = () => {
+        if(vc.pending)
+            return;
+        vc.pending = true;
+        requestAnimationFrame(() => {
+            vc.pending = false;
+            updateViewport(vc);
+        });
+    };
+    el.addEventListener('scroll', request, {'passive': true});
+    new ResizeObserver(request).observe(el);
+    request();
+}
+
+function keepArea(vc) {
+    const t = vc.tileSize;
+    const v = vc.viewport;
+    return {'x': v.x - t, 'y': v.y - t, 'w': v.w + 2 * t, 'h': v.h + 2 * t};
+}
+
+// tiles outside of area are closed, null area evicts all
+function evictTiles(vc, area) {
+    for(const [key, tile] of vc.tiles) {
+        if(!area || !intersects(tile, area)) {
+            tile.bitmap.close();
+            vc.tiles.delete(key);
+        }
+    }
+}
+
+function drawVirtualTile(vc, tile) {
+    vc.ctx.drawImage(tile.bitmap, tile.x - vc.viewport.x, tile.y - vc.viewport.y);
+}
+
+// canvas is moved to the scroll position and redrawn, the server is told what is visible
+function updateViewport(vc) {
+    const el = vc.element;
+    if(!el.isConnected) {
+        evictTiles(vc, null);
+        return;
+    }
+    const v = {'x': el.scrollLeft, 'y': el.scrollTop, 'w': el.clientWidth, 'h': el.clientHeight};
+    if(v.x === vc.viewport.x && v.y === vc.viewport.y && v.w === vc.viewport.w && v.h === vc.viewport.h)
+        return;
+    vc.viewport = v;
+    if(vc.canvas.width !== v.w || vc.canvas.height !== v.h) {
+        vc.canvas.width = v.w;
+        vc.canvas.height = v.h;
+    }
+    vc.canvas.style.left = v.x + 'px';
+    vc.canvas.style.top = v.y + 'px';
+    evictTiles(vc, keepArea(vc));
+    vc.ctx.clearRect(0, 0, v.w, v.h);
+    for(const tile of vc.tiles.values()) {
+        if(intersects(tile, v))
+            drawVirtualTile(vc, tile);
+    }
+    socket.send(JSON.stringify({'type': 'event', 'element': vc.id, 'event': 'virtual_viewport',
+        'properties': {'x': String(v.x), 'y': String(v.y), 'width': String(v.w), 'height': String(v.h)}}));
+}
+
+// tiles are stored and the visible ones are drawn, tiles scrolled away while in transit are dropped
+function virtualTiles(buffer, bytes) {
+    const headerOffset = bytes[1] + 4;
+    const handle = bytes[headerOffset];
+    const vc = virtualCanvases.get(handle);
+    if(!vc) {
+        errlog("Binary", "Unknown virtual canvas: " + handle);
+        return;
+    }
+    return Promise.resolve(decodeFrame(buffer, bytes, 4, headerOffset, null, null)).then(tiles =>
+        Promise.all(tiles.map(tile => tile.bitmap ? tile.bitmap : createImageBitmap(new ImageData(tile.pixels, tile.w, tile.h))))
+        .then(bitmaps => {
+            const keep = keepArea(vc);
+            bitmaps.forEach((bitmap, i) => {
+                const t = tiles[i];
+                const tile = {'x': t.x, 'y': t.y, 'w': t.w, 'h': t.h, 'bitmap': bitmap};
+                if(!intersects(tile, keep)) {
+                    bitmap.close();
+                    return;
+                }
+                const key = t.x + ',' + t.y;
+                const old = vc.tiles.get(key);
+                if(old)
+                    old.bitmap.close();
+                vc.tiles.set(key, tile);
+                if(intersects(tile, vc.viewport))
+                    drawVirtualTile(vc, tile);
+            });
+        }));
+}
+
+// returns a promise if the message is not completely handled when returned
 function handleBinary(buffer) {
     const bytes = new Uint32Array(buffer);
     if(!bytes || bytes.length === 0) {
         errlog("Binary", "Invalid buffer", buffer);
         return;
     }
-    const type = bytes[0];
-    if(type === 0xAAA) {
+    const version = bytes[0] >>> 16;
+    const type = bytes[0] & 0xFFFF;
+    if(version > ProtocolVersion) {
+        errlog("Binary", "Unsupported protocol version: " + version);
+        return;
+    }
+    if(type === VirtualTilesId)
+        return virtualTiles(buffer, bytes);
+    if(type === CanvasId || type === CanvasFrameId || type === CanvasIndexedFrameId || type === ImageBitmapId || type === CanvasBlitId) {
         const datalen = bytes[1] * 4;
         const idLen = bytes[2];
         const headerLen = bytes[3];
         let dataOffset = 4 * 4; //id, datalen, idlen, headerlen, data<datalen>, header<headerlen>, id<idlen>
-        const data = new Uint8ClampedArray(buffer, dataOffset, datalen);
         const headerOffset = bytes[1] + 4;
-        const x = bytes[headerOffset];
-        const y = bytes[headerOffset + 1];
-        const w = bytes[headerOffset + 2];
-        const h = bytes[headerOffset + 3];
-        const as_draw = bytes[headerOffset + 4];
-        const idOffset = (5 * 4) + dataOffset + datalen;
-        const words = new Uint16Array(buffer, idOffset, idLen);
-        let id = "";
-        for(let i = 0 ; i < words.length && words[i] > 0; i++)
-            id += String.fromCharCode(words[i]);
-        const element = document.getElementById(id);
-
-        if(!element) {
-            errlog(id, "Canvas not found '" + id + "'" + " at: ", idOffset, " len: ", idLen);
+        let fields = headerOffset;
+        let target = null;
+        if(version >= 1) {
+            const handle = bytes[fields++];
+            target = canvasHandles.get(handle);
+            if(!target) {
+                errlog("Binary", "Unknown canvas handle: " + handle);
+                return;
+            }
+            if(!target.element.isConnected) { // element is recreated
+                target.element = document.getElementById(target.id);
+                target.ctx = null;
+                if(!target.element) {
+                    canvasHandles.delete(handle);
+                    errlog(target.id, "Canvas not found");
+                    return;
+                }
+            }
+        } else {
+            const id = ownerId(buffer, bytes);
+            const element = document.getElementById(id);
+            if(!element) {
+                errlog(id, "Canvas not found '" + id + "'" + " len: ", idLen);
+                return;
+            }
+            target = {'id': id, 'element': element, 'ctx': null};
+        }
+        const x = bytes[fields];
+        const y = bytes[fields + 1];
+        const w = bytes[fields + 2];
+        const h = bytes[fields + 3];
+        const flags = bytes[fields + 4];
+        const scale = Math.max(1, (flags >>> ScaleShift) & 0xFF);
+        const id = target.id;
+
+        if(type === ImageBitmapId)
+            return loadImage(ownerId(buffer, bytes), id, buffer, bytes, headerOffset, flags);
+
+        if(type === CanvasBlitId) {
+            // paced tiles received before are presented first, as the blit copies them
+            if(framesToPresent.has(id))
+                presentFrame(id);
+            const pos = new Int32Array(buffer, dataOffset, 2);
+            canvasBlit(target.element, [x | 0, y | 0, w, h], [pos[0], pos[1]]);
             return;
         }
 
+        // draw ends, tiles are either put now or after the animation frame
+        const present = (ctx, tiles) => {
+            for(const tile of tiles)
+                tile.scale = scale;
+            if(flags & AtomicFlag) {
+                const frame = assembleFrame(id, ctx, tiles, flags);
+                if(!(flags & CommitFlag))
+                    return;
+                ctx = frame ? frame.ctx : null;
+                tiles = frame ? frame.tiles : [];
+            }
+            if(flags & PacedFlag) {
+                queueFrame(id, ctx, tiles, flags);
+                return;
+            }
+            if(ctx)
+                putTiles(ctx, tiles);
+            if(flags & DrawFlag)
+                notifyDraw(id);
+        };
+
         if (datalen > 0) { // otherwise this is just a tail
-            const ctx = element.getContext("2d", {alpha:false});
-            if(ctx) {
-                if(w > 0 && h > 0) {
-                    const bytesLen = w * h * 4;
-                    const imageData = data.length === bytesLen ? new ImageData(data, w, h) : new ImageData(data.slice(0, bytesLen), w, h);
-                    ctx.putImageData(imageData, x, y);
-                }
-            } else {
+            if(!target.ctx)
+                target.ctx = target.element.getContext("2d", {alpha:false});
+            const ctx = target.ctx;
+            if(!ctx) {
                 errlog(id, "has no graphics context");
                 return;
             }
+            if(type === CanvasId) {
+                putTile(ctx, buffer, dataOffset, x, y, w, h, datalen);
+            } else {
+                let pos = 4;
+                let palette = null;
+                if(type === CanvasIndexedFrameId) {
+                    const paletteLen = bytes[pos++];
+                    if(paletteLen > 0)
+                        palettes.set(id, bytes.slice(pos, pos + paletteLen));
+                    pos += paletteLen;
+                    palette = palettes.get(id);
+                    if(!palette) {
+                        errlog(id, "has no palette");
+                        pos = headerOffset; // skip tiles, server will resend them
+                    }
+                }
+                // all tiles of the frame in one pass
+                if(!tileReferences.has(id))
+                    tileReferences.set(id, new Map());
+                const tiles = decodeFrame(buffer, bytes, pos, headerOffset, palette, tileReferences.get(id));
+                if(tiles instanceof Promise)
+                    return tiles.then(decoded => present(ctx, decoded));
+                present(ctx, tiles);
+                return;
+            }
         }    
 
-
-        // if as_draw AND there is a notification request - send a notify
-        if ((as_draw != 0) && event_notifiers.has("canvas_draw")) {
-            socket.send(JSON.stringify({
-                                            'type': 'event',
-                                            'element': id,
-                                            'event': 'event_notify',
-                                            'properties':{
-                                                'name': "canvas_draw",
-                                                'msgid': 0
-                                            }
-                                        }));
-            
-        }
+        present(null, []);
 
     } else {
         errlog("Unknown", "Unknown binary message type: " + type.toString(16), bytes);
     }
 }
 
+// canvas as a source is copied before it is drawn, hence overlapping rects are fine
+function canvasBlit(element, rect, pos) {
+    const ctx = element.getContext("2d");
+    if(!ctx) {
+        errlog(element.id, "has no graphics context");
+        return;
+    }
+    ctx.drawImage(element, rect[0], rect[1], rect[2], rect[3], pos[0], pos[1], rect[2], rect[3]);
+}
+
 function paintImage(element, imageName, pos, rect, clip) {
-    const image = document.getElementById(imageName);
+    const image = findImage(imageName);
     if(!image) {
         errlog(imageName, "not found on paint");
         return;
@@ -556,7 +1118,7 @@ function canvasDraw(element, commands) {
             ctx.scale(commands[cmdpos++], commands[cmdpos++]);
             break;
         case 'drawImage':
-            const image = document.getElementById(commands[cmdpos++]);
+            const image = findImage(commands[cmdpos++]);
             if(!image) {
                 errlog("drawImage", commands[cmdpos - 1] + " image not found");
                 return;
@@ -564,7 +1126,7 @@ function canvasDraw(element, commands) {
             ctx.drawImage(image, commands[cmdpos++], commands[cmdpos++]);
             break;
         case 'drawImageRect':
-            const image1 = document.getElementById(commands[cmdpos++]);
+            const image1 = findImage(commands[cmdpos++]);
             if(!image1) {
                 errlog("drawImageRect", commands[cmdpos - 1] + " image not found");
                 return;
@@ -576,7 +1138,7 @@ function canvasDraw(element, commands) {
                           commands[cmdpos++]);
             break;
         case 'drawImageClip':
-            const image2 = document.getElementById(commands[cmdpos++]);
+            const image2 = findImage(commands[cmdpos++]);
             if(!image2) {
                 errlog("drawImageClip", commands[cmdpos - 1] + " image not found");
                 return;
@@ -889,6 +1451,8 @@ function handleJsonCommand(msg) {
             errlog(msg.element, 'element not found:"' + msg.element + '"');
             return;
         }
+        if(framesToPresent.has(msg.element))
+            presentFrame(msg.element); // a paced frame is drawn before what follows it
         switch(msg.type) {
             case 'html':
                 el.innerHTML = msg.html;
@@ -912,6 +1476,18 @@ function handleJsonCommand(msg) {
             case 'canvas_draw':
                 canvasDraw(el, msg.commands);
                 break;
+            case 'canvas_handle':
+                registerCanvas(el, msg.handle);
+                break;
+            case 'virtual_canvas':
+                createVirtualCanvas(el, msg.handle, msg.width, msg.height, msg.tile);
+                break;
+            case 'canvas_blit':
+                canvasBlit(el, msg.rect, msg.pos);
+                break;
+            case 'remove_image':
+                removeImage(msg.image);
+                break;
             case 'remove_attribute':
                 el.removeAttribute(msg.attribute)
                 break;
@@ -946,15 +1522,35 @@ socket.onopen = function(event) {
     socket.send(JSON.stringify({'type': 'ui_ready'}));
 };
 
+function handleMessage(data) {
+    if(data instanceof ArrayBuffer)
+        return handleBinary(data);
+    const msg = JSON.parse(data);
+    handleJson(msg);
+}
+
+// set when a message is decoded asynchronously, following messages wait it to keep their order
+let pendingMessages = null;
+
+function setPending(promise) {
+    const pending = promise.catch(error => catchLog(error, ""));
+    pendingMessages = pending;
+    pending.then(() => {
+        if(pendingMessages === pending)
+            pendingMessages = null;
+    });
+}
+
 socket.onmessage =
         function(event) {
+        if(pendingMessages) {
+            setPending(pendingMessages.then(() => handleMessage(event.data)));
+            return;
+        }
         try {        
-            if(event.data instanceof ArrayBuffer) {
-                handleBinary(event.data);
-                return;
-            }
-            const msg = JSON.parse(event.data);
-            handleJson(msg);
+            const result = handleMessage(event.data);
+            if(result instanceof Promise)
+                setPending(result);
         } catch(error) {
             catchLog(error, event.data);
         }
@@ -0,0 +1,98 @@
+#include "worker_pool.h"
+#include <algorithm>
+
+using namespace Gempyre;
+
+WorkerPool::WorkerPool(unsigned threads) {
+    threads = std::max(1U, threads);
+    m_threads.reserve(threads - 1);
+    for(auto i = 1U; i < threads; ++i)
+        m_threads.emplace_back([this]() {work();});
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_exit = true;
+    }
+    m_start.notify_all();
+    for(auto& thread : m_threads)
+        thread.join();
+}
+
+WorkerPool& WorkerPool::shared() {
+    static WorkerPool pool;
+    return pool;
+}
+
+void WorkerPool::run(size_t count, const Job& job) {
+    if(count == 0)
+        return;
+    const auto chunks = static_cast<unsigned>(std::min<size_t>(count, size()));
+    if(chunks == 1) {
+        job(0, count, 0);
+        return;
+    }
+    std::lock_guard<std::mutex> run_lock(m_run_mutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        m_count = count;
+        m_chunks = chunks;
+        m_error = nullptr;
+        m_done.store(0);
+        ++m_round;
+        m_next.store(static_cast<uint64_t>(m_round) << 32);
+    }
+    m_start.notify_all();
+    execute(m_round);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finish.wait(lock, [this, chunks]() {return m_done.load() == chunks;});
+    m_job = nullptr;
+    if(m_error)
+        std::rethrow_exception(m_error);
+}
+
+void WorkerPool::work() {
+    unsigned round = 0;
+    for(;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [this, round]() {return m_exit || m_round != round;});
+            if(m_exit)
+                return;
+            round = m_round;
+        }
+        execute(round);
+    }
+}
+
+void WorkerPool::execute(unsigned round) {
+    auto ticket = m_next.load();
+    for(;;) {
+        // a chunk is taken only from this round, a late worker must not use up a ticket of the next one
+        if(static_cast<unsigned>(ticket >> 32) != round)
+            return;
+        const auto chunk = static_cast<unsigned>(ticket & 0xFFFFFFFFU);
+        const auto chunks = m_chunks.load();
+        if(chunk >= chunks)
+            return;
+        if(!m_next.compare_exchange_weak(ticket, ticket + 1))
+            continue;   // ticket is reloaded
+        ++ticket;
+        // the round cannot end before this chunk is done, hence the job and count stay
+        const auto begin = m_count * chunk / chunks;
+        const auto end = m_count * (chunk + 1) / chunks;
+        try {
+            (*m_job)(begin, end, chunk);
+        } catch(...) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!m_error)
+                m_error = std::current_exception();
+        }
+        if(m_done.fetch_add(1) + 1 == chunks) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_finish.notify_all();
+        }
+    }
+}
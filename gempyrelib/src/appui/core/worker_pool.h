@@ -0,0 +1,56 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#ifdef WASM
+    #error "Worker pool is not supported in WASM builds"
+#endif
+
+#include <functional>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <cstdint>
+
+namespace Gempyre {
+
+// Fixed set of threads that split an index range between them.
+// Used to prepare and encode canvas tiles in parallel, results are indexed
+// so the caller can still send them in the original order.
+class WorkerPool {
+public:
+    // begin, end, slot - slot is unique within one run and less than size()
+    using Job = std::function<void (size_t, size_t, unsigned)>;
+    explicit WorkerPool(unsigned threads = std::thread::hardware_concurrency());
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    // number of slots, calling thread included
+    [[nodiscard]] unsigned size() const {return static_cast<unsigned>(m_threads.size()) + 1U;}
+    // run job over [0, count) in contiguous ranges, calling thread takes part and returns when all are done
+    // an exception thrown by the job is rethrown here, job shall not call run
+    void run(size_t count, const Job& job);
+    // pool shared by all canvases
+    static WorkerPool& shared();
+private:
+    void work();
+    void execute(unsigned round);
+private:
+    std::vector<std::thread> m_threads{};
+    std::mutex m_run_mutex{};   // one run at time
+    std::mutex m_mutex{};
+    std::condition_variable m_start{};
+    std::condition_variable m_finish{};
+    const Job* m_job{nullptr};
+    size_t m_count{0};
+    std::atomic<unsigned> m_chunks{0}; // read by late workers of a previous round
+    unsigned m_round{0};
+    std::atomic<uint64_t> m_next{0}; // round in high bits, so a late worker cannot take a chunk of the next run
+    std::atomic<unsigned> m_done{0};
+    std::exception_ptr m_error{};
+    bool m_exit{false};
+};
+}
+#endif // WORKER_POOL_H
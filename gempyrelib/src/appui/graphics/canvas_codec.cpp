@@ -0,0 +1,167 @@
+#include "canvas_codec.h"
+#include <lodepng.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+using namespace Gempyre;
+
+static constexpr dataT RunBit = 0x80000000U;
+static constexpr int MinRun = 3;                // shorter runs are cheaper as literals
+static constexpr size_t AdaptiveRleRatio = 8;   // rle is used as is if it is this much smaller than raw
+static constexpr unsigned AdaptiveDeflateSkip = 16; // tiles not tried with deflate after it did not pay off
+
+static size_t words(size_t bytes) {
+    return (bytes + sizeof(dataT) - 1) / sizeof(dataT);
+}
+
+TileEncoder::Encoded TileEncoder::encode(const dataT* pixels, int stride, int width, int height, bool delta) {
+    const auto raw_bytes = static_cast<size_t>(width) * static_cast<size_t>(height) * sizeof(dataT);
+    const Encoded raw{Codec::Raw, 0, raw_bytes};
+    const auto offset = m_buffer.size();
+    const auto compression = (delta && m_compression == CanvasElement::Compression::None) ? CanvasElement::Compression::Rle : m_compression;
+    switch(compression) {
+    case CanvasElement::Compression::None:
+        return raw;
+    case CanvasElement::Compression::Rle: {
+        const auto rle_words = rle_encode(pixels, stride, width, height, m_buffer);
+        return rle_words > 0 ? Encoded{Codec::Rle, offset, rle_words * sizeof(dataT)} : raw;
+        }
+    case CanvasElement::Compression::Deflate: {
+        const auto deflate_bytes = deflate_encode(pixels, stride, width, height);
+        return deflate_bytes > 0 ? Encoded{Codec::Deflate, offset, deflate_bytes} : raw;
+        }
+    case CanvasElement::Compression::Jpeg: {
+        const auto jpeg_bytes = jpeg_encode(pixels, stride, width, height);
+        return jpeg_bytes > 0 ? Encoded{Codec::Jpeg, offset, jpeg_bytes} : raw;
+        }
+    case CanvasElement::Compression::Adaptive: {
+        const auto rle_bytes = rle_encode(pixels, stride, width, height, m_buffer) * sizeof(dataT);
+        // flat content, rle is good enough and a lot faster
+        if(rle_bytes > 0 && rle_bytes * AdaptiveRleRatio <= raw_bytes)
+            return {Codec::Rle, offset, rle_bytes};
+        if(m_deflate_skip > 0) {
+            --m_deflate_skip;
+            return rle_bytes > 0 ? Encoded{Codec::Rle, offset, rle_bytes} : raw;
+        }
+        const auto deflate_offset = m_buffer.size();
+        const auto deflate_bytes = deflate_encode(pixels, stride, width, height);
+        if(deflate_bytes == 0 || deflate_bytes * 2 > raw_bytes)
+            m_deflate_skip = AdaptiveDeflateSkip; // looks like noisy content, do not waste time for a while
+        if(deflate_bytes > 0 && (rle_bytes == 0 || deflate_bytes < rle_bytes)) {
+            std::copy(m_buffer.begin() + static_cast<ptrdiff_t>(deflate_offset), m_buffer.end(), m_buffer.begin() + static_cast<ptrdiff_t>(offset));
+            m_buffer.resize(offset + words(deflate_bytes));
+            return {Codec::Deflate, offset, deflate_bytes};
+        }
+        m_buffer.resize(deflate_offset);
+        return rle_bytes > 0 ? Encoded{Codec::Rle, offset, rle_bytes} : raw;
+        }
+    }
+    return raw;
+}
+
+size_t TileEncoder::rle_encode(const dataT* pixels, int stride, int width, int height, std::vector<dataT>& out) {
+    constexpr auto NoToken = std::numeric_limits<size_t>::max();
+    const auto start = out.size();
+    const auto raw = static_cast<size_t>(width) * static_cast<size_t>(height);
+    auto token = NoToken; // position of the current token
+    for(auto j = 0; j < height; ++j) {
+        const auto row = pixels + static_cast<ptrdiff_t>(j) * stride;
+        for(auto i = 0; i < width;) {
+            const auto value = row[i];
+            auto n = i + 1;
+            while(n < width && row[n] == value)
+                ++n;
+            const auto count = static_cast<dataT>(n - i);
+            if(token != NoToken && (out[token] & RunBit) && out.back() == value) {
+                out[token] += count; // run continues e.g. from the previous row
+            } else if(count >= MinRun) {
+                token = out.size();
+                out.push_back(RunBit | count);
+                out.push_back(value);
+            } else {
+                if(token == NoToken || (out[token] & RunBit)) {
+                    token = out.size();
+                    out.push_back(0);
+                }
+                out[token] += count;
+                out.insert(out.end(), count, value);
+            }
+            i = n;
+        }
+        if(out.size() - start >= raw) { // does not pay off
+            out.resize(start);
+            return 0;
+        }
+    }
+    return out.size() - start;
+}
+
+size_t TileEncoder::deflate_encode(const dataT* pixels, int stride, int width, int height) {
+    const auto row_bytes = static_cast<size_t>(width) * sizeof(dataT);
+    m_bytes.resize(row_bytes * static_cast<size_t>(height));
+    for(auto j = 0; j < height; ++j) {
+        std::memcpy(m_bytes.data() + row_bytes * static_cast<size_t>(j), pixels + static_cast<ptrdiff_t>(j) * stride, row_bytes);
+    }
+    m_compressed.clear();
+    const auto error = lodepng::compress(m_compressed, m_bytes.data(), m_bytes.size());
+    if(error != 0 || m_compressed.size() >= m_bytes.size())
+        return 0;
+    const auto offset = m_buffer.size();
+    m_buffer.resize(offset + words(m_compressed.size()), 0);
+    std::memcpy(m_buffer.data() + offset, m_compressed.data(), m_compressed.size());
+    return m_compressed.size();
+}
+
+size_t TileEncoder::jpeg_encode(const dataT* pixels, int stride, int width, int height) {
+    m_compressed.clear();
+    const auto bytes = m_jpeg.encode(pixels, stride, width, height, m_compressed);
+    if(bytes == 0 || bytes >= static_cast<size_t>(width) * static_cast<size_t>(height) * sizeof(dataT))
+        return 0;
+    const auto offset = m_buffer.size();
+    m_buffer.resize(offset + words(bytes), 0);
+    std::memcpy(m_buffer.data() + offset, m_compressed.data(), bytes);
+    return bytes;
+}
+
+bool TileEncoder::decode(Codec codec, const dataT* data, size_t bytes, dataT* pixels, size_t pixel_count) {
+    switch(codec) {
+    case Codec::Raw:
+        if(bytes < pixel_count * sizeof(dataT))
+            return false;
+        std::copy(data, data + pixel_count, pixels);
+        return true;
+    case Codec::Rle: {
+        const auto end = data + words(bytes);
+        const auto out_end = pixels + pixel_count;
+        while(data < end) {
+            const auto token = *data++;
+            const auto count = token & ~RunBit;
+            if(count > static_cast<size_t>(out_end - pixels))
+                return false;
+            if(token & RunBit) {
+                if(data == end)
+                    return false;
+                pixels = std::fill_n(pixels, count, *data++);
+            } else {
+                if(count > static_cast<size_t>(end - data))
+                    return false;
+                pixels = std::copy_n(data, count, pixels);
+                data += count;
+            }
+        }
+        return pixels == out_end;
+        }
+    case Codec::Deflate: {
+        std::vector<unsigned char> out;
+        const auto error = lodepng::decompress(out, reinterpret_cast<const unsigned char*>(data), bytes);
+        if(error != 0 || out.size() != pixel_count * sizeof(dataT))
+            return false;
+        std::memcpy(pixels, out.data(), out.size());
+        return true;
+        }
+    case Codec::Jpeg:
+        return false;
+    }
+    return false;
+}
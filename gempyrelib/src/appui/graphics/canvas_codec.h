@@ -0,0 +1,59 @@
+#ifndef CANVAS_CODEC_H
+#define CANVAS_CODEC_H
+
+#include "gempyre_types.h"
+#include "gempyre_graphics.h"
+#include "jpeg_encoder.h"
+#include <vector>
+#include <cstdint>
+
+namespace Gempyre {
+
+// Compresses tile pixels before they are sent to the client.
+// Encoded tiles are appended into an internal buffer that is reused between frames.
+class TileEncoder {
+public:
+    // payload encodings, values are shared with gempyre.js
+    enum class Codec : dataT {
+        Raw = 0,    // pixels as is
+        Rle = 1,    // 32-bit words, token with high bit set is a run: count, value, otherwise count literals follow
+        Deflate = 2,// zlib stream of RGBA bytes
+        Jpeg = 3    // baseline JPEG, lossy
+    };
+
+    struct Encoded {
+        Codec codec;
+        size_t offset;  // in words from data(), not used for Raw
+        size_t bytes;   // payload length, padded to words when sent
+    };
+
+    void set_compression(CanvasElement::Compression compression) {m_compression = compression;}
+    [[nodiscard]] CanvasElement::Compression compression() const {return m_compression;}
+    void set_quality(int quality) {if(quality != m_jpeg.quality()) m_jpeg.set_quality(quality);}
+
+    // start a new frame, previous encoded data is discarded
+    void clear() {m_buffer.clear();}
+    // encode a tile, Raw is returned if compression is off or does not pay off,
+    // XOR delta is mostly zeroes, hence it is run-length encoded also when compression is off
+    [[nodiscard]] Encoded encode(const dataT* pixels, int stride, int width, int height, bool delta = false);
+    [[nodiscard]] const dataT* data() const {return m_buffer.data();}
+
+    // appends encoded words, returns number of words, 0 if result is not smaller than the raw
+    static size_t rle_encode(const dataT* pixels, int stride, int width, int height, std::vector<dataT>& out);
+    // decode payload, false if data is malformed, Jpeg is not decoded here
+    [[nodiscard]] static bool decode(Codec codec, const dataT* data, size_t bytes, dataT* pixels, size_t pixel_count);
+private:
+    size_t deflate_encode(const dataT* pixels, int stride, int width, int height);
+    size_t jpeg_encode(const dataT* pixels, int stride, int width, int height);
+private:
+    CanvasElement::Compression m_compression{CanvasElement::Compression::None};
+    std::vector<dataT> m_buffer{};
+    std::vector<unsigned char> m_bytes{};
+    std::vector<unsigned char> m_compressed{};
+    unsigned m_deflate_skip{0};
+    JpegEncoder m_jpeg{};
+};
+
+}
+
+#endif // CANVAS_CODEC_H
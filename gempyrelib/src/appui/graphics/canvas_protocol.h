@@ -0,0 +1,27 @@
+#ifndef CANVAS_PROTOCOL_H
+#define CANVAS_PROTOCOL_H
+
+#include "gempyre_types.h"
+#include "canvas_codec.h"
+#include <cstddef>
+
+// Tile records of canvas frames, shared by CanvasElement and VirtualCanvas, the values must match gempyre.js.
+
+namespace Gempyre {
+
+static constexpr auto TileRecordHeader = 6; // x, y, width, height, codec, payload bytes
+static constexpr size_t FrameMaxElements = 4096 * 1024; // frame message is split if it would be bigger (16MB)
+
+// encoded payload is padded to words
+inline size_t payload_size(const TileEncoder::Encoded& encoded) {
+    return (encoded.bytes + sizeof(dataT) - 1) / sizeof(dataT);
+}
+
+inline bool intersects(const Rect& a, const Rect& b) {
+    return a.x < b.x + b.width && b.x < a.x + a.width &&
+           a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+}
+
+#endif // CANVAS_PROTOCOL_H
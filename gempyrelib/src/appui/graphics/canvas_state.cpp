@@ -0,0 +1,105 @@
+#include "canvas_state.h"
+#include "canvas_protocol.h"
+#include <algorithm>
+#include <atomic>
+
+using namespace Gempyre;
+
+static constexpr unsigned HashLanes = 8;
+
+// each step is a bijection of the lane state, hence any single pixel change is always seen
+static inline uint32_t mix(uint32_t v, uint32_t k) {
+    v *= k;
+    return v ^ (v >> 15);
+}
+
+static inline uint64_t fmix(uint64_t v) {
+    v ^= v >> 33;
+    v *= 0xff51afd7ed558ccdULL;
+    v ^= v >> 33;
+    v *= 0xc4ceb9fe1a85ec53ULL;
+    return v ^ (v >> 33);
+}
+
+static inline bool operator==(const Rect& a, const Rect& b) {
+    return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+}
+
+uint64_t TileCache::hash(const dataT* pixels, int stride, int width, int height) {
+    // two sets of lanes with different operations, so that collision needs both to collide
+    uint32_t a[HashLanes];
+    uint32_t b[HashLanes];
+    for(auto k = 0U; k < HashLanes; ++k) {
+        a[k] = 0x9E3779B9U * (k + 1);
+        b[k] = 0x85EBCA6BU * (k + 1);
+    }
+    const auto blocks = static_cast<int>(static_cast<unsigned>(width) & ~(HashLanes - 1));
+    for(auto j = 0; j < height; ++j) {
+        const auto row = pixels + static_cast<ptrdiff_t>(j) * stride;
+        for(auto i = 0; i < blocks; i += HashLanes) {
+            for(auto k = 0U; k < HashLanes; ++k) {
+                a[k] = mix(a[k] ^ row[i + static_cast<int>(k)], 0xCC9E2D51U);
+                b[k] = mix(b[k] + row[i + static_cast<int>(k)], 0x1B873593U);
+            }
+        }
+        for(auto i = blocks; i < width; ++i) {
+            a[0] = mix(a[0] ^ row[i], 0xCC9E2D51U);
+            b[0] = mix(b[0] + row[i], 0x1B873593U);
+        }
+    }
+    auto h = fmix((static_cast<uint64_t>(static_cast<uint32_t>(width)) << 32) | static_cast<uint32_t>(height));
+    for(auto k = 0U; k < HashLanes; ++k) {
+        h = fmix(h ^ ((static_cast<uint64_t>(a[k]) << 32) | b[k]));
+    }
+    return h;
+}
+
+bool TileCache::contains(const Rect& rect, uint64_t hash) const {
+    return std::find_if(m_tiles.begin(), m_tiles.end(), [&rect, hash](const auto& t) {
+        return t.hash == hash && t.rect == rect;
+    }) != m_tiles.end();
+}
+
+void TileCache::store(const Rect& rect, uint64_t hash) {
+    invalidate(rect);
+    m_tiles.push_back({rect, hash});
+}
+
+void TileCache::invalidate(const Rect& rect) {
+    m_tiles.erase(std::remove_if(m_tiles.begin(), m_tiles.end(), [&rect](const auto& t) {
+        return intersects(t.rect, rect);
+    }), m_tiles.end());
+}
+
+const TileReferences::Reference* TileReferences::find(const Rect& rect) const {
+    const auto it = std::find_if(m_references.begin(), m_references.end(), [&rect](const auto& r) {
+        return r.rect == rect;
+    });
+    return it != m_references.end() ? &(*it) : nullptr;
+}
+
+dataT TileReferences::store(const Rect& rect, const dataT* pixels, int stride, int width, int height) {
+    auto it = std::find_if(m_references.begin(), m_references.end(), [&rect](const auto& r) {
+        return r.rect == rect;
+    });
+    if(it == m_references.end()) {
+        m_references.erase(std::remove_if(m_references.begin(), m_references.end(), [&rect](const auto& r) {
+            return intersects(r.rect, rect);
+        }), m_references.end());
+        m_references.push_back({rect, 0, {}});
+        it = m_references.end() - 1;
+    }
+    it->serial = ++m_serial;
+    it->words.resize(static_cast<size_t>(width) * static_cast<size_t>(height));
+    auto pos = it->words.begin();
+    for(auto j = 0; j < height; ++j) {
+        const auto row = pixels + static_cast<ptrdiff_t>(j) * stride;
+        pos = std::copy(row, row + width, pos);
+    }
+    return it->serial;
+}
+
+dataT CanvasState::next_handle() {
+    static std::atomic<dataT> handles{0};
+    return ++handles;
+}
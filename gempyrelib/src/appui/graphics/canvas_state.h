@@ -0,0 +1,172 @@
+#ifndef CANVAS_STATE_H
+#define CANVAS_STATE_H
+
+#include "gempyre_types.h"
+#include "data.h"
+#include "canvas_codec.h"
+#include "gempyre_bitmap.h"
+#include "quality_controller.h"
+#include <vector>
+#include <cstdint>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <string>
+
+namespace Gempyre {
+
+// Remembers content hashes of the tiles that are sent to the client,
+// so an unchanged tile is not sent again.
+class TileCache {
+public:
+    // fast hash over pixel rows, independent lanes let compiler to vectorize
+    static uint64_t hash(const dataT* pixels, int stride, int width, int height);
+    // true if the client has this exact rect with this content
+    [[nodiscard]] bool contains(const Rect& rect, uint64_t hash) const;
+    // rect is sent, what was under it is overwritten
+    void store(const Rect& rect, uint64_t hash);
+    // rect is modified by some other means
+    void invalidate(const Rect& rect);
+    void clear() {m_tiles.clear();}
+    [[nodiscard]] bool empty() const {return m_tiles.empty();}
+    [[nodiscard]] size_t size() const {return m_tiles.size();}
+private:
+    struct Tile {
+        Rect rect;
+        uint64_t hash;
+    };
+    std::vector<Tile> m_tiles{};
+};
+
+// Last sent content of tiles, client keeps the same so that a tile can be sent
+// as a XOR delta against it.
+class TileReferences {
+public:
+    struct Reference {
+        Rect rect;
+        dataT serial;   // identifies content, client checks it before applying a delta
+        std::vector<dataT> words;
+    };
+    // reference of exactly this rect, nullptr if there is none
+    [[nodiscard]] const Reference* find(const Rect& rect) const;
+    // copy tile content as a reference of rect, what was under it is dropped, returns its serial
+    dataT store(const Rect& rect, const dataT* pixels, int stride, int width, int height);
+    void clear() {m_references.clear();}
+    [[nodiscard]] size_t size() const {return m_references.size();}
+private:
+    std::vector<Reference> m_references{};
+    dataT m_serial{0};
+};
+
+// Per canvas bookkeeping of what is sent to the client, shared between CanvasElement copies.
+struct CanvasState {
+    static dataT next_handle();
+    const dataT handle{next_handle()}; // client refers canvas with this
+    bool registered{false};            // client knows the handle
+    TileCache tiles{};
+    unsigned generation{0}; // when server generation changes, client may have lost some data
+    DataPool pool{};        // tile buffers, reused when broadcaster has released them
+    std::vector<Rect> changed{}; // per paint scratch, kept to avoid reallocation
+    struct TileSource {
+        const dataT* pixels;
+        int stride;
+        int width;  // in words
+        int height;
+    };
+    std::vector<TileSource> sources{}; // changed tiles data
+    std::vector<uint64_t> hashes{};    // candidate tiles hashes
+    CanvasElement::Compression compression{CanvasElement::Compression::None};
+    int quality{JpegEncoder::DefaultQuality};
+    std::vector<TileEncoder> encoders{}; // one per worker slot, tiles are encoded in parallel
+    std::vector<TileEncoder::Encoded> encoded{}; // changed tiles encoded
+    std::vector<const dataT*> payloads{};  // changed tiles encoded data, nullptr if raw
+    std::vector<size_t> offsets{};         // records positions in a frame
+    std::vector<dataT> packed{};  // indexed tiles, 4 pixels per word
+    std::vector<dataT> palette{}; // palette that client has, empty if none
+    bool delta{false};            // tiles are sent as XOR deltas when possible
+    TileReferences references{};
+    struct Delta {
+        dataT flags;
+        dataT base;     // serial of the reference the delta is against
+        dataT serial;   // serial of the result
+    };
+    std::vector<Delta> deltas{};  // changed tiles delta info
+    std::vector<dataT> xored{};   // delta tiles data
+    struct Pacing {
+        bool enabled{false};
+        bool subscribed{false};     // ack handler is added
+        bool in_callback{false};    // draws of the frame callback are a single frame
+        unsigned outstanding{0};    // draws sent but not yet presented by the client
+        std::chrono::steady_clock::time_point sent{};
+        std::function<void()> callback{};
+        int watchdog{0};            // timer that forgets lost acknowledges
+        struct Held {
+            bool waiting;
+            int x;
+            int y;
+            CanvasDataPtr canvas;   // copy of the drawn view, or pixels shared with the drawn Bitmap
+            IndexedBitmap indexed;  // used if canvas is nullptr
+        };
+        std::vector<Held> held{};   // latest draw per position while client is busy
+    };
+    Pacing pacing{};
+    bool adaptive{false};           // quality follows the load
+    QualityController controller{};
+    CanvasElement::QualityCallback quality_changed{};
+    std::chrono::milliseconds frame_latency{0}; // from the latest paced draw to its acknowledge
+    int scale{1};                   // resolution divisor of the latest paint
+    bool atomic{false};             // client presents draws as a whole
+    bool progressive{false};        // big draws are previewed in a low resolution
+    bool refining{false};           // full resolution tiles after the preview are sent in small frames
+    std::vector<Rect> refined{};    // full resolution tiles, while the preview is sent
+    std::vector<TileSource> refined_sources{};
+    std::vector<size_t> order{};            // refinement order scratch, kept to avoid reallocation
+    std::vector<Rect> sorted{};
+    std::vector<TileSource> sorted_sources{};
+    bool images_subscribed{false};  // image load handler is added
+    std::unordered_map<std::string, std::function<void (std::string_view)>> image_loaded{}; // pending load callbacks
+    CanvasDataPtr scaled{};         // downscaled bitmap, buffer is reused
+
+    // quality follows the load, returns true if the level has changed
+    bool adapt_quality(const QualityController::Sample& sample, std::chrono::steady_clock::time_point now) {
+        const auto was_lossy = controller.state().compression == CanvasElement::Compression::Jpeg;
+        if(!controller.update(sample, now))
+            return false;
+        // client does not have the exact pixels of lossy tiles, hence they are resent when the quality is restored
+        if(was_lossy && controller.state().compression != CanvasElement::Compression::Jpeg)
+            forget_sent();
+        return true;
+    }
+
+    // next tiles are sent again and as keyframes
+    void forget_sent() {
+        tiles.clear();
+        references.clear();
+    }
+};
+
+
+// Per virtual canvas bookkeeping, shared between VirtualCanvas copies.
+struct VirtualCanvasState {
+    const dataT handle{CanvasState::next_handle()};
+    int width{0};
+    int height{0};
+    int tile_size{0};
+    Rect viewport{0, 0, 0, 0};          // as reported by the client
+    std::unordered_set<uint64_t> sent{}; // tiles that the client has, row << 32 | column
+    VirtualCanvas::TileProvider provider{};
+    CanvasElement::Compression compression{CanvasElement::Compression::None};
+    unsigned generation{0};
+    DataPool pool{};
+    std::vector<Rect> needed{};         // per update scratch, visible tiles that the client does not have
+    std::vector<Bitmap> bitmaps{};      // provided content of the needed tiles, reused
+    std::vector<TileEncoder> encoders{};
+    std::vector<TileEncoder::Encoded> encoded{};
+    std::vector<const dataT*> payloads{};
+    std::vector<size_t> offsets{};
+};
+
+}
+
+#endif // CANVAS_STATE_H
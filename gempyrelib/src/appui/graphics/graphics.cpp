@@ -3,28 +3,199 @@
 #include "data.h"
 #include "canvas_data.h"
 #include "gempyre_internal.h"
+#include "core.h"
 #include "gempyre_bitmap.h"
+#include "canvas_state.h"
+#include "canvas_protocol.h"
+#include "worker_pool.h"
 #include <any>
+#include <atomic>
 #include <cassert>
 #include <cmath>
+#include <cstring>
+#include <numeric>
 
 
 using namespace Gempyre;
 
 static constexpr auto TileWidth = 640;  // used for server spesific stuff - bigger than a limit (16384) causes random crashes (There is a issue somewhere, this not really work if something else)
 static constexpr auto TileHeight = 640; // as there are some header info
+static constexpr dataT DeltaKeyframe = 0x10;   // codec flag: tile is a reference for following deltas
+static constexpr dataT DeltaXor = 0x20;        // codec flag: tile is XOR against the reference
+static constexpr auto DeltaHeader = 2;         // base serial, serial - follows record header if flags are set
+static constexpr dataT DrawFlag = 0x1;   // frame header: draw ends here, client notifies
+static constexpr dataT PacedFlag = 0x2;  // frame header: client presents in animation frame and acknowledges draws
+static constexpr auto FrameAckTimeout = 1s; // unacknowledged frames are forgotten, e.g. the page has been reloaded
+static constexpr auto ScaleShift = 8;    // frame header: bits 8 - 15 are resolution divisor of tiles
+static constexpr dataT AtomicFlag = 0x4; // frame header: part of a draw that is presented as a whole, part index in bits 16 - 31
+static constexpr dataT CommitFlag = 0x8; // frame header: atomic draw is complete, part count in bits 16 - 31
+static constexpr auto PartShift = 16;
+static constexpr auto ProgressiveScale = 8;  // resolution divisor of the preview
+static constexpr auto ProgressiveMinPixels = 1024 * 1024; // smaller draws are not previewed
+static constexpr size_t ProgressiveFrameElements = TileWidth * TileHeight; // refinement is sent in small frames
+static constexpr auto ReadHeader = 7;    // read tile: type, read id, tile index, x, y, width, height
+
+// bounding rect of tiles
+static Rect bounds(const std::vector<Rect>& tiles, size_t first, size_t last) {
+    auto left = tiles[first].x;
+    auto top = tiles[first].y;
+    auto right = tiles[first].x + tiles[first].width;
+    auto bottom = tiles[first].y + tiles[first].height;
+    for(auto k = first + 1; k < last; ++k) {
+        left = std::min(left, tiles[k].x);
+        top = std::min(top, tiles[k].y);
+        right = std::max(right, tiles[k].x + tiles[k].width);
+        bottom = std::max(bottom, tiles[k].y + tiles[k].height);
+    }
+    return {left, top, right - left, bottom - top};
+}
+
+static size_t record_size(const TileEncoder::Encoded& encoded, const CanvasState::Delta& delta) {
+    return TileRecordHeader + (delta.flags ? DeltaHeader : 0) + payload_size(encoded);
+}
+
+// candidate tiles that client already has are removed, the rest are stored into the cache
+static void drop_unchanged(CanvasState& state) {
+    auto& changed = state.changed;
+    auto& sources = state.sources;
+    size_t count = 0;
+    for(size_t k = 0; k < changed.size(); ++k) {
+        const auto tile = changed[k];
+        if(state.tiles.contains(tile, state.hashes[k])) {
+            GempyreUtils::log(GempyreUtils::LogLevel::Debug_Trace, "Skip unchanged canvas frame", tile.x, tile.y, tile.width, tile.height);
+            continue;
+        }
+        state.tiles.store(tile, state.hashes[k]);
+        changed[count] = tile;
+        sources[count] = sources[k];
+        ++count;
+    }
+    changed.resize(count);
+    sources.resize(count);
+}
+
+// parts of an atomic draw are dropped together
+static unsigned next_group() {
+    static std::atomic<unsigned> groups{0};
+    auto group = ++groups;
+    return group != 0 ? group : ++groups;
+}
+
+// tiles of different resolutions are not comparable, hence what is sent is forgotten when the resolution changes
+static void set_scale(CanvasState& state, int scale) {
+    if(state.scale == scale)
+        return;
+    state.forget_sent();
+    state.scale = scale;
+}
+
+// codec that the tiles are sent with
+static CanvasElement::Compression selected_compression(const CanvasState& state) {
+    return state.adaptive ? state.controller.state().compression : state.compression;
+}
+
+// box filtered copy of the canvas, 1 / scale of its size, into a buffer that is reused
+static BitmapView downscale(CanvasState& state, const BitmapView& canvas, int scale) {
+    const auto width = (canvas.width() + scale - 1) / scale;
+    const auto height = (canvas.height() + scale - 1) / scale;
+    auto& scaled = state.scaled;
+    if(!scaled || scaled->width() != width || scaled->height() != height)
+        scaled = std::make_shared<CanvasData>(width, height);
+    const auto trg = scaled->data();
+    WorkerPool::shared().run(static_cast<size_t>(height), [&](size_t begin, size_t end, unsigned) {
+        for(auto j = static_cast<int>(begin); j < static_cast<int>(end); ++j) {
+            const auto top = j * scale;
+            const auto rows = std::min(scale, canvas.height() - top);
+            for(auto i = 0; i < width; ++i) {
+                const auto left = i * scale;
+                const auto cols = std::min(scale, canvas.width() - left);
+                dataT sums[4] = {0, 0, 0, 0};
+                for(auto r = 0; r < rows; ++r) {
+                    const auto row = canvas.row(top + r) + left;
+                    for(auto c = 0; c < cols; ++c) {
+                        for(auto b = 0; b < 4; ++b)
+                            sums[b] += (row[c] >> (8 * b)) & 0xFF;
+                    }
+                }
+                const auto count = static_cast<dataT>(rows * cols);
+                dataT pixel = 0;
+                for(auto b = 0; b < 4; ++b)
+                    pixel |= ((sums[b] + count / 2) / count) << (8 * b);
+                trg[j * width + i] = pixel;
+            }
+        }
+    });
+    return BitmapView(scaled->data(), width, height);
+}
+
+// refinement is sent from the centre of the changed area outward, where the viewer likely looks first
+static void order_from_centre(CanvasState& state) {
+    auto& changed = state.changed;
+    auto& sources = state.sources;
+    const auto area = bounds(changed, 0, changed.size());
+    const auto distance = [&area](const Rect& tile) {
+        // doubled coordinates keep centres in integers
+        const auto dx = static_cast<int64_t>(2 * tile.x + tile.width - 2 * area.x - area.width);
+        const auto dy = static_cast<int64_t>(2 * tile.y + tile.height - 2 * area.y - area.height);
+        return dx * dx + dy * dy;
+    };
+    auto& order = state.order;
+    order.resize(changed.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) {
+        return distance(changed[a]) < distance(changed[b]);
+    });
+    // sorted buffers are swapped in, the previous ones are reused on the next draw
+    auto& sorted_tiles = state.sorted;
+    auto& sorted_sources = state.sorted_sources;
+    sorted_tiles.clear();
+    sorted_sources.clear();
+    for(const auto k : order) {
+        sorted_tiles.push_back(changed[k]);
+        sorted_sources.push_back(sources[k]);
+    }
+    changed.swap(sorted_tiles);
+    sources.swap(sorted_sources);
+}
+
+// write k:th changed tile as a record
+static void write_record(dataT* trgPos, const CanvasState& state, size_t k) {
+    const auto& tile = state.changed[k];
+    const auto& payload = state.encoded[k];
+    const auto& delta = state.deltas[k];
+    *trgPos++ = static_cast<Gempyre::dataT>(tile.x);
+    *trgPos++ = static_cast<Gempyre::dataT>(tile.y);
+    *trgPos++ = static_cast<Gempyre::dataT>(tile.width);
+    *trgPos++ = static_cast<Gempyre::dataT>(tile.height);
+    *trgPos++ = static_cast<Gempyre::dataT>(payload.codec) | delta.flags;
+    *trgPos++ = static_cast<Gempyre::dataT>(payload.bytes);
+    if(delta.flags) {
+        *trgPos++ = delta.base;
+        *trgPos++ = delta.serial;
+    }
+    if(payload.codec == TileEncoder::Codec::Raw) {
+        const auto& source = state.sources[k];
+        for(int h = 0; h < source.height; h++) {
+            const auto lineStart = source.pixels + (h * source.stride);
+            trgPos = std::copy(lineStart, lineStart + source.width, trgPos);
+        }
+    } else {
+        const auto data = state.payloads[k];
+        std::copy(data, data + payload_size(payload), trgPos);
+    }
+}
 
 
  CanvasElement::CanvasElement(const CanvasElement& other)
         : Element{other},
-          m_tile{other.m_tile},
+          m_state{other.m_state},
           m_width{other.m_width},
           m_height{other.m_height}{
     }
 
 CanvasElement::CanvasElement(CanvasElement&& other)
         : Element{std::move(other)},
-            m_tile{std::move(other.m_tile)},
+            m_state{std::move(other.m_state)},
             m_width{other.m_width},
             m_height{other.m_height}{
     }
@@ -41,7 +212,7 @@ CanvasElement::CanvasElement(Ui& ui, const Element& parent)
 
 // Copy operator. 
 CanvasElement& CanvasElement::operator=(const CanvasElement& other) {
-    m_tile = other.m_tile;
+    m_state = other.m_state;
     m_width = other.m_width;
     m_height = other.m_height;
     return *this;
@@ -49,97 +220,412 @@ CanvasElement& CanvasElement::operator=(const CanvasElement& other) {
 
 /// Move operator.
 CanvasElement& CanvasElement::operator=(CanvasElement&& other) {
-    m_tile = std::move(other.m_tile);
+    m_state = std::move(other.m_state);
     m_width = other.m_width;
     m_height = other.m_height;
     return *this;
 }
 
 CanvasElement::~CanvasElement() {
-    m_tile.reset();
 }
 
 
-void CanvasElement::paint(const CanvasDataPtr& canvas, int x_pos, int y_pos, bool as_draw) {
-    GempyreUtils::log(GempyreUtils::LogLevel::Debug, "paint", x_pos, y_pos, as_draw);
-    if(!canvas) {
-        GempyreUtils::log(GempyreUtils::LogLevel::Error, "Won't paint as canvas is NULL");
-        return;
+void CanvasElement::prepare_paint() {
+    if(!m_state) {
+        m_state = std::make_shared<CanvasState>();
+    }
+    const auto generation = ref().binary_generation();
+    if(m_state->generation != generation) {
+        m_state->forget_sent(); // client may have missed some tiles, therefore resend all
+        m_state->palette.clear();
+        m_state->registered = false;
+        m_state->generation = generation;
+    }
+    if(!m_state->registered) {
+        // frames refer the canvas with a handle
+        ref().send(*this, "canvas_handle", "handle", m_state->handle);
+        m_state->registered = true;
     }
-    if(!m_tile) {
-        m_tile = std::shared_ptr<CanvasData>(new CanvasData(TileWidth, TileHeight, m_id));
+    if(m_state->adaptive)
+        adapt_quality();
+}
+
+void CanvasElement::adapt_quality() {
+    const auto load = ref().binary_load();
+    const auto& pacing = m_state->pacing;
+    if(!m_state->adapt_quality({load.queued_bytes, load.backpressure, load.drops, load.latency,
+        pacing.enabled ? pacing.outstanding : 0, pacing.enabled ? m_state->frame_latency : 0ms},
+        std::chrono::steady_clock::now()))
+        return;
+    const auto& state = m_state->controller.state();
+    GempyreUtils::log(GempyreUtils::LogLevel::Info, "Canvas quality", m_id, static_cast<int>(state.level), state.reason);
+    if(m_state->quality_changed) {
+        // called later, as the callback may draw
+        ui().after(0ms, [callback = m_state->quality_changed, state]() {
+            callback(state);
+        });
     }
+}
+
+// a skipped draw sends only its notification
+bool CanvasElement::skip_draw(int x_pos, int y_pos, bool as_draw) {
+    if(!as_draw || !m_state->adaptive || !m_state->controller.skip())
+        return false;
+    GempyreUtils::log(GempyreUtils::LogLevel::Debug, "Skip canvas draw", m_id, x_pos, y_pos);
+    m_state->changed.clear();
+    send_tiles(CanvasData::CanvasFrameId, {}, std::max(0, x_pos), std::max(0, y_pos), true);
+    return true;
+}
+
+void CanvasElement::paint(const BitmapView& bitmap, int x_pos, int y_pos, bool as_draw) {
+    GempyreUtils::log(GempyreUtils::LogLevel::Debug, "paint", x_pos, y_pos, as_draw);
 
-    if(canvas->height() <= 0 || canvas->width() <= 0 ) {
+    prepare_paint();
+
+    if(bitmap.empty()) {
         GempyreUtils::log(GempyreUtils::LogLevel::Debug, "Won't paint as canvas size is 0");
         return;
     }
 
+    if(skip_draw(x_pos, y_pos, as_draw))
+        return;
+
+    // under load bitmap is sent in a lower resolution, if its position is aligned to it
+    const auto quality_scale = m_state->adaptive ? m_state->controller.state().scale : 1;
+    const auto scale = x_pos % quality_scale == 0 && y_pos % quality_scale == 0 ? quality_scale : 1;
+    set_scale(*m_state, scale);
+    const auto canvas = scale > 1 ? downscale(*m_state, bitmap, scale) : bitmap;
+    x_pos /= scale;
+    y_pos /= scale;
+
     // This is not ok - as we dont know all extents
     // if (y_pos + canvas->height() < 0 || x_pos + canvas->width() < 0) {
     //    return; 
     //}
         
     //const auto canvas_height = y_pos < 0 ? canvas->height() + y_pos : canvas->height();
-    const auto canvas_height =  canvas->height();
+    const auto canvas_height =  canvas.height();
 
     const auto y = y_pos < 0 ? -y_pos : 0;
     //const auto canvas_width = x_pos < 0 ? canvas->width() + x_pos : canvas->width();
-    const auto canvas_width =  canvas->width();
+    const auto canvas_width =  canvas.width();
     const auto x = x_pos < 0 ? -x_pos : 0;
 
     x_pos = std::max(0, x_pos);
     y_pos = std::max(0, y_pos);
 
-    GempyreUtils::log(GempyreUtils::LogLevel::Debug, "Sending canvas data");
-
-    bool is_last = false;
+    // tiles that differ from what is already sent, in canvas coordinates
+    auto& changed = m_state->changed;
+    auto& sources = m_state->sources;
+    auto& hashes = m_state->hashes;
+    changed.clear();
+    sources.clear();
 
     if(y < canvas_height && x < canvas_width) {
-
         for(auto j = y ; j < canvas_height ; j += TileHeight) {
             const auto height = std::min(TileHeight, canvas_height - j);
             for(auto i = x ; i < canvas_width ; i += TileWidth) {
-                assert(!is_last);
-                is_last = (canvas_height - j <= TileHeight) && (canvas_width - i <= TileWidth);
                 const auto width = std::min(TileWidth, canvas_width - i);
-                const auto srcPos = canvas->data() + i + (j * canvas->width());
-                GempyreUtils::log(GempyreUtils::LogLevel::Debug_Trace, "Copy canvas frame", i, j, width, height);
-                for(int h = 0; h < height; h++) {
-                    const auto lineStart = srcPos + (h * canvas->width());
-                    auto trgPos = m_tile->data() + width * h;
-                    assert(trgPos < m_tile->data() + m_tile->width() * m_tile->height());
-                    std::copy(lineStart, lineStart + width, trgPos);
-                }
-                m_tile->ref().writeHeader({static_cast<Gempyre::dataT>(i + x_pos),
-                                    static_cast<Gempyre::dataT>(j + y_pos),
-                                    static_cast<Gempyre::dataT>(width),
-                                    static_cast<Gempyre::dataT>(height),
-                                    static_cast<Gempyre::dataT>(as_draw && is_last)});
-                
-                GempyreUtils::log(GempyreUtils::LogLevel::Debug, "Sending canvas frame", i, j, width, height, m_tile->size(),  (width * height + 4) * 4 + 20 + 16);
-                #ifdef GEMPYRE_IS_DEBUG
-                if (m_tile->size() != static_cast<size_t>((width * height + 4) * 4 + 20 + 16)) {
-                    GempyreUtils::log(GempyreUtils::LogLevel::Debug, m_tile->dump());                
-                }
-            //  assert(m_tile->size() == static_cast<size_t>((width * height + 4) * 4 + 20 + 16));
-                #endif         
-                ref().send(m_tile->ptr(), is_last); // last is not droppable
+                changed.push_back({i + x_pos, j + y_pos, width, height});
+                sources.push_back({canvas.row(j) + i, canvas.stride(), width, height});
             }
         }
-    } else {
-        is_last = true;
-        if (as_draw) {
-            m_tile->ref().writeHeader({static_cast<Gempyre::dataT>(x_pos),
-                                        static_cast<Gempyre::dataT>(y_pos),
-                                        static_cast<Gempyre::dataT>(0),
-                                        static_cast<Gempyre::dataT>(0),
-                                        static_cast<Gempyre::dataT>(is_last)});
-            ref().send(m_tile->ptr(), is_last);   // last is not droppable                         
+    }
+
+    hashes.resize(changed.size());
+    WorkerPool::shared().run(changed.size(), [&sources, &hashes](size_t begin, size_t end, unsigned) {
+        for(auto k = begin; k < end; ++k)
+            hashes[k] = TileCache::hash(sources[k].pixels, sources[k].stride, sources[k].width, sources[k].height);
+    });
+    drop_unchanged(*m_state);
+
+    size_t pixels = 0;
+    for(const auto& tile : changed)
+        pixels += static_cast<size_t>(tile.width) * static_cast<size_t>(tile.height);
+    if(m_state->progressive && scale == 1 && !m_state->atomic && x == 0 && y == 0
+        && x_pos % ProgressiveScale == 0 && y_pos % ProgressiveScale == 0 && pixels >= ProgressiveMinPixels) {
+        send_preview(canvas, x_pos, y_pos);
+        order_from_centre(*m_state);
+        m_state->refining = true;
+    }
+
+    send_tiles(CanvasData::CanvasFrameId, {}, x_pos, y_pos, as_draw);
+    m_state->refining = false;
+}
+
+// changed tiles are sent downscaled, not as a draw, and they are not stored as they are refined right after
+void CanvasElement::send_preview(const BitmapView& canvas, int x_pos, int y_pos) {
+    auto& state = *m_state;
+    state.refined.swap(state.changed);
+    state.refined_sources.swap(state.sources);
+    state.changed.clear();
+    state.sources.clear();
+    const auto preview = downscale(state, canvas, ProgressiveScale);
+    for(const auto& tile : state.refined) {
+        // partial pixels at edges would be upscaled over the neighbours, they are left for the refinement
+        const auto width = tile.width / ProgressiveScale;
+        const auto height = tile.height / ProgressiveScale;
+        if(width <= 0 || height <= 0)
+            continue;
+        const auto i = (tile.x - x_pos) / ProgressiveScale;
+        const auto j = (tile.y - y_pos) / ProgressiveScale;
+        state.changed.push_back({tile.x / ProgressiveScale, tile.y / ProgressiveScale, width, height});
+        state.sources.push_back({preview.row(j) + i, preview.stride(), width, height});
+    }
+    GempyreUtils::log(GempyreUtils::LogLevel::Debug, "Canvas preview", state.changed.size());
+    // scale is set directly, as the cache of full resolution tiles stays valid
+    const auto delta = state.delta;
+    const auto scale = state.scale;
+    state.delta = false;
+    state.scale = ProgressiveScale;
+    send_tiles(CanvasData::CanvasFrameId, {}, x_pos, y_pos, false);
+    state.delta = delta;
+    state.scale = scale;
+    state.changed.swap(state.refined);
+    state.sources.swap(state.refined_sources);
+}
+
+// indices are width bytes per row
+void CanvasElement::paint(const uint8_t* indices, int bmp_width, int bmp_height, const IndexedBitmap::Palette& palette, int x_pos, int y_pos, bool as_draw) {
+    GempyreUtils::log(GempyreUtils::LogLevel::Debug, "paint indexed", x_pos, y_pos, as_draw);
+
+    prepare_paint();
+
+    if(bmp_width <= 0 || bmp_height <= 0) {
+        GempyreUtils::log(GempyreUtils::LogLevel::Debug, "Won't paint as bitmap size is 0");
+        return;
+    }
+
+    if(skip_draw(x_pos, y_pos, as_draw))
+        return;
+
+    set_scale(*m_state, 1); // indexed bitmaps are always sent in full resolution
+
+    const auto palette_changed = !std::equal(palette.begin(), palette.end(), m_state->palette.begin(), m_state->palette.end());
+    // tiles are expanded in the client, hence a palette change changes them all
+    const auto palette_hash = TileCache::hash(palette.data(), static_cast<int>(palette.size()), static_cast<int>(palette.size()), 1);
+
+    const auto y = y_pos < 0 ? -y_pos : 0;
+    const auto x = x_pos < 0 ? -x_pos : 0;
+    x_pos = std::max(0, x_pos);
+    y_pos = std::max(0, y_pos);
+
+    auto& changed = m_state->changed;
+    auto& sources = m_state->sources;
+    auto& hashes = m_state->hashes;
+    auto& packed = m_state->packed;
+    changed.clear();
+    sources.clear();
+
+    size_t total = 0;
+    for(auto j = y ; j < bmp_height ; j += TileHeight) {
+        const auto height = std::min(TileHeight, bmp_height - j);
+        for(auto i = x ; i < bmp_width ; i += TileWidth) {
+            const auto width = std::min(TileWidth, bmp_width - i);
+            const auto words = (static_cast<size_t>(width * height) + sizeof(dataT) - 1) / sizeof(dataT);
+            changed.push_back({i + x_pos, j + y_pos, width, height});
+            sources.push_back({nullptr, static_cast<int>(words), static_cast<int>(words), 1});
+            total += words;
         }
     }
-    assert(is_last);
-    GempyreUtils::log(GempyreUtils::LogLevel::Debug, "Sent canvas data");
+    packed.resize(total);
+    total = 0;
+    for(auto& source : sources) {
+        source.pixels = packed.data() + total;
+        total += static_cast<size_t>(source.width);
+    }
+
+    hashes.resize(changed.size());
+    WorkerPool::shared().run(changed.size(), [&](size_t begin, size_t end, unsigned) {
+        for(auto k = begin; k < end; ++k) {
+            const auto& tile = changed[k];
+            const auto& source = sources[k];
+            const auto words = packed.data() + (source.pixels - packed.data());
+            words[source.width - 1] = 0; // padding
+            auto trgPos = reinterpret_cast<uint8_t*>(words);
+            for(int h = 0; h < tile.height; h++) {
+                const auto lineStart = indices + (tile.x - x_pos) + ((tile.y - y_pos + h) * bmp_width);
+                trgPos = std::copy(lineStart, lineStart + tile.width, trgPos);
+            }
+            hashes[k] = TileCache::hash(words, source.width, source.width, 1) + palette_hash;
+        }
+    });
+    drop_unchanged(*m_state);
+
+    // palette is in front of tile records: size, colors
+    std::vector<dataT> prefix{palette_changed ? static_cast<dataT>(palette.size()) : 0};
+    if(palette_changed)
+        prefix.insert(prefix.end(), palette.begin(), palette.end());
+    // client has the palette only if a frame carries it, i.e. there are tiles to send
+    const auto palette_sent = palette_changed && !changed.empty();
+    send_tiles(CanvasData::CanvasIndexedFrameId, prefix, x_pos, y_pos, as_draw);
+    if(palette_sent)
+        m_state->palette.assign(palette.begin(), palette.end());
+}
+
+// changed tiles are stored as references, and if there is a previous one, the tile is replaced with XOR of those
+void CanvasElement::make_deltas() {
+    auto& sources = m_state->sources;
+    auto& deltas = m_state->deltas;
+    auto& xored = m_state->xored;
+    // references are looked up before any of them is replaced
+    std::vector<std::pair<const TileReferences::Reference*, size_t>> bases(sources.size(), {nullptr, 0});
+    size_t total = 0;
+    for(auto k = 0U; k < sources.size(); ++k) {
+        const auto& source = sources[k];
+        const auto words = static_cast<size_t>(source.width) * static_cast<size_t>(source.height);
+        const auto reference = m_state->references.find(m_state->changed[k]);
+        if(reference && reference->words.size() == words) {
+            bases[k] = {reference, total};
+            total += words;
+            deltas[k] = {DeltaKeyframe | DeltaXor, reference->serial, 0};
+        } else {
+            deltas[k] = {DeltaKeyframe, 0, 0};
+        }
+    }
+    xored.resize(total);
+    WorkerPool::shared().run(sources.size(), [&](size_t begin, size_t end, unsigned) {
+        for(auto k = begin; k < end; ++k) {
+            const auto [reference, offset] = bases[k];
+            if(!reference)
+                continue;
+            const auto& source = sources[k];
+            auto ref = reference->words.begin();
+            auto trgPos = xored.begin() + static_cast<ptrdiff_t>(offset);
+            for(int h = 0; h < source.height; h++) {
+                const auto lineStart = source.pixels + (h * source.stride);
+                trgPos = std::transform(lineStart, lineStart + source.width, ref, trgPos, [](auto a, auto b) {
+                    return a ^ b;
+                });
+                ref += source.width;
+            }
+        }
+    });
+    for(auto k = 0U; k < sources.size(); ++k) {
+        auto& source = sources[k];
+        // reference is the actual tile, not XOR
+        deltas[k].serial = m_state->references.store(m_state->changed[k], source.pixels, source.stride, source.width, source.height);
+        if(deltas[k].flags & DeltaXor)
+            source = {xored.data() + bases[k].second, source.width, source.width, source.height};
+    }
+}
+
+void CanvasElement::set_atomic(bool atomic) {
+    if(!m_state) {
+        m_state = std::make_shared<CanvasState>();
+    }
+    m_state->atomic = atomic;
+}
+
+void CanvasElement::set_progressive(bool progressive) {
+    if(!m_state) {
+        m_state = std::make_shared<CanvasState>();
+    }
+    m_state->progressive = progressive;
+}
+
+void CanvasElement::set_delta(bool delta) {
+    if(!m_state) {
+        m_state = std::make_shared<CanvasState>();
+    }
+    m_state->delta = delta;
+    m_state->references.clear();
+}
+
+void CanvasElement::send_tiles(dataT type, const std::vector<dataT>& prefix, int x_pos, int y_pos, bool as_draw) {
+    const auto& changed = m_state->changed;
+    GempyreUtils::log(GempyreUtils::LogLevel::Debug, "Sending canvas data", changed.size());
+
+    // pixel values are needed for lossy compression, hence it is not used for indexed tiles
+    const auto selected = selected_compression(*m_state);
+    const auto lossy = selected == Compression::Jpeg;
+    const auto compression = lossy && type == CanvasData::CanvasIndexedFrameId ? Compression::Adaptive : selected;
+
+    auto& deltas = m_state->deltas;
+    deltas.assign(changed.size(), {0, 0, 0});
+    if(m_state->delta && compression != Compression::Jpeg)
+        make_deltas();
+
+    // tiles are encoded in parallel, each worker slot has an own encoder
+    auto& workers = WorkerPool::shared();
+    auto& encoders = m_state->encoders;
+    auto& encoded = m_state->encoded;
+    auto& payloads = m_state->payloads;
+    if(encoders.size() < workers.size())
+        encoders.resize(workers.size());
+    encoded.resize(changed.size());
+    payloads.resize(changed.size());
+    workers.run(changed.size(), [this, compression, &encoders, &encoded, &payloads, &deltas](size_t begin, size_t end, unsigned slot) {
+        auto& encoder = encoders[slot];
+        encoder.set_compression(compression);
+        encoder.set_quality(m_state->quality);
+        encoder.clear();
+        for(auto k = begin; k < end; ++k) {
+            const auto& source = m_state->sources[k];
+            const auto is_delta = (deltas[k].flags & DeltaXor) != 0;
+            encoded[k] = encoder.encode(source.pixels, source.stride, source.width, source.height, is_delta);
+        }
+        // encoder buffer does not grow anymore
+        for(auto k = begin; k < end; ++k)
+            payloads[k] = encoded[k].codec == TileEncoder::Codec::Raw ? nullptr : encoder.data() + encoded[k].offset;
+    });
+
+    const auto paced = as_draw && m_state->pacing.enabled ? PacedFlag : 0;
+    const auto flags = paced | (static_cast<dataT>(m_state->scale) << ScaleShift);
+    // atomic draw is sent in droppable parts and committed with a tail that is not droppable
+    const auto atomic = m_state->atomic;
+    const auto group = atomic ? next_group() : 0;
+    dataT parts = 0;
+
+    // changed tiles are packed as records into a frame, that is sent as a single message
+    const auto frame_max = m_state->refining ? ProgressiveFrameElements : FrameMaxElements;
+    auto& offsets = m_state->offsets;
+    for(size_t first = 0; first < changed.size(); ++parts) {
+        auto last = first;
+        size_t elements = prefix.size();
+        offsets.clear();
+        do {
+            const auto& tile = changed[last];
+            GempyreUtils::log(GempyreUtils::LogLevel::Debug_Trace, "Copy canvas tile", tile.x, tile.y, tile.width, tile.height, static_cast<int>(encoded[last].codec), encoded[last].bytes);
+            offsets.push_back(elements);
+            elements += record_size(encoded[last], deltas[last]);
+            ++last;
+        } while(last < changed.size() && elements + record_size(encoded[last], deltas[last]) <= frame_max);
+        const auto is_last = last == changed.size();
+        const auto frame_rect = bounds(changed, first, last);
+        // buffer is written once here and then handed over to the broadcaster as is
+        auto frame = m_state->pool.acquire(elements, CanvasData::versioned(type), CanvasData::NO_ID,
+                            {m_state->handle,
+                            static_cast<Gempyre::dataT>(frame_rect.x),
+                            static_cast<Gempyre::dataT>(frame_rect.y),
+                            static_cast<Gempyre::dataT>(frame_rect.width),
+                            static_cast<Gempyre::dataT>(frame_rect.height),
+                            atomic ? AtomicFlag | (parts << PartShift) | flags : (as_draw && is_last ? DrawFlag : 0) | flags});
+        const auto data = frame->data();
+        assert(data + elements == frame->endPtr());
+        std::copy(prefix.begin(), prefix.end(), data);
+        // record positions are known, hence they are written in parallel
+        workers.run(last - first, [this, data, first, &offsets](size_t begin, size_t end, unsigned) {
+            for(auto n = begin; n < end; ++n)
+                write_record(data + offsets[n], *m_state, first + n);
+        });
+        GempyreUtils::log(GempyreUtils::LogLevel::Debug, "Sending canvas frame", last - first, frame->size());
+        ref().send(std::move(frame), atomic || !is_last, group); // last is not droppable, frames are sent in order from this thread
+        first = last;
+    }
+
+    if(atomic ? (parts > 0 || as_draw) : (changed.empty() && as_draw)) {
+        // nothing to draw, but the draw notification or the commit has to be delivered, send just a tail
+        auto tail = m_state->pool.acquire(0, CanvasData::versioned(CanvasData::CanvasFrameId), CanvasData::NO_ID,
+                                    {m_state->handle,
+                                    static_cast<Gempyre::dataT>(x_pos),
+                                    static_cast<Gempyre::dataT>(y_pos),
+                                    static_cast<Gempyre::dataT>(0),
+                                    static_cast<Gempyre::dataT>(0),
+                                    (as_draw ? DrawFlag : 0) | (atomic ? AtomicFlag | CommitFlag | (parts << PartShift) : 0) | flags});
+        ref().send(std::move(tail), false);   // last is not droppable
+    }
+    GempyreUtils::log(GempyreUtils::LogLevel::Debug, "Tile buffer allocations", m_state->pool.allocations());
 }
 
 std::string CanvasElement::add_image(std::string_view url, const std::function<void (std::string_view id)> &loaded) {
@@ -154,6 +640,61 @@ std::string CanvasElement::add_image(std::string_view url, const std::function<v
     return name;
 }
 
+std::string CanvasElement::add_image(const Bitmap& bitmap, const std::function<void (std::string_view id)>& loaded) {
+    const auto name = generateId("image");
+    if(!bitmap.m_canvas || bitmap.empty()) {
+        GempyreUtils::log(GempyreUtils::LogLevel::Error, "Won't add an empty image");
+        return name;
+    }
+    prepare_paint(); // image is sent along the canvas, that is notified when the image is loaded
+    if(loaded) {
+        m_state->image_loaded.insert_or_assign(name, loaded);
+        if(!m_state->images_subscribed) {
+            m_state->images_subscribed = true;
+            ref().add_handler(m_id, "image_loaded", [state = m_state](const Event& ev) {
+                const auto image = ev.properties.find("image");
+                if(image == ev.properties.end())
+                    return;
+                const auto it = state->image_loaded.find(image->second);
+                if(it == state->image_loaded.end())
+                    return;
+                const auto callback = std::move(it->second);
+                state->image_loaded.erase(it);
+                callback(image->second);
+            });
+        }
+    }
+    // image is a single tile record, alpha is needed, hence not lossy
+    const auto& canvas = *bitmap.m_canvas;
+    TileEncoder encoder;
+    encoder.set_compression(m_state->compression == Compression::Jpeg ? Compression::Adaptive : m_state->compression);
+    const auto encoded = encoder.encode(canvas.data(), canvas.width(), canvas.width(), canvas.height());
+    const auto words = payload_size(encoded);
+    auto image = m_state->pool.acquire(TileRecordHeader + words, CanvasData::versioned(CanvasData::ImageBitmapId), name,
+                            {m_state->handle, 0, 0,
+                            static_cast<Gempyre::dataT>(canvas.width()),
+                            static_cast<Gempyre::dataT>(canvas.height()),
+                            loaded ? DrawFlag : 0});
+    auto trgPos = image->data();
+    *trgPos++ = 0;
+    *trgPos++ = 0;
+    *trgPos++ = static_cast<Gempyre::dataT>(canvas.width());
+    *trgPos++ = static_cast<Gempyre::dataT>(canvas.height());
+    *trgPos++ = static_cast<Gempyre::dataT>(encoded.codec);
+    *trgPos++ = static_cast<Gempyre::dataT>(encoded.bytes);
+    const auto payload = encoded.codec == TileEncoder::Codec::Raw ? canvas.data() : encoder.data() + encoded.offset;
+    std::copy(payload, payload + words, trgPos);
+    GempyreUtils::log(GempyreUtils::LogLevel::Debug, "Sending image", name, static_cast<int>(encoded.codec), encoded.bytes);
+    ref().send(std::move(image), false);
+    return name;
+}
+
+void CanvasElement::remove_image(std::string_view imageId) {
+    if(m_state)
+        m_state->image_loaded.erase(std::string{imageId});
+    ref().send(*this, "remove_image", "image", imageId);
+}
+
 #if 0
 std::vector<std::string> CanvasElement::add_images(const std::vector<std::string>& urls, const std::function<void (const std::vector<std::string>)>& loaded) {
     std::vector<std::string> names;
@@ -177,6 +718,7 @@ std::vector<std::string> CanvasElement::add_images(const std::vector<std::string
 #endif
 
 void CanvasElement::paint_image(std::string_view imageId, int x, int y, const Rect& clippingRect) const {
+    invalidate_tiles();
     auto ui = const_cast<GempyreInternal*>(&ref());
     if(clippingRect.width <= 0 || clippingRect.height <= 0)
         ui->send(*this, "paint_image",
@@ -192,6 +734,7 @@ void CanvasElement::paint_image(std::string_view imageId, int x, int y, const Re
 void CanvasElement::paint_image(std::string_view imageId, const Rect& targetRect, const Element::Rect& clippingRect) const {
     if(targetRect.width <= 0 || targetRect.height <= 0)
         return;
+    invalidate_tiles();
     auto ui = const_cast<GempyreInternal*>(&ref());
     if(clippingRect.width <= 0 || clippingRect.height <= 0)
         ui->send(*this, "paint_image",
@@ -209,6 +752,7 @@ void CanvasElement::paint_image(std::string_view imageId, const Rect& targetRect
 void CanvasElement::draw(const CanvasElement::CommandList &canvasCommands)  {
     if(canvasCommands.empty())
         return;
+    invalidate_tiles(); // commands can draw anywhere
     std::vector<std::string> commandString;
     /*std::transform(canvasCommands.begin(), canvasCommands.end(), std::back_inserter(commandString), [](auto&& arg) -> std::string {
          if(const auto doubleval = std::get_if<double>(&arg))
@@ -261,6 +805,77 @@ void CanvasElement::draw_completed(const DrawCallback& drawCallback, DrawNotify
     }         
 }
 
+void CanvasElement::blit(const Element::Rect& source, int x, int y) {
+    if(source.width <= 0 || source.height <= 0)
+        return;
+    prepare_paint(); // blit refers the canvas by its handle
+    send_held(); // copy what is drawn before
+    m_state->tiles.invalidate({x, y, source.width, source.height});
+    // text messages are sent before the queued tiles, hence the blit is sent along them
+    auto blit = m_state->pool.acquire(2, CanvasData::versioned(CanvasData::CanvasBlitId), CanvasData::NO_ID,
+                            {m_state->handle,
+                            static_cast<Gempyre::dataT>(source.x),
+                            static_cast<Gempyre::dataT>(source.y),
+                            static_cast<Gempyre::dataT>(source.width),
+                            static_cast<Gempyre::dataT>(source.height),
+                            0});
+    blit->data()[0] = static_cast<Gempyre::dataT>(x);
+    blit->data()[1] = static_cast<Gempyre::dataT>(y);
+    ref().send(std::move(blit), false);
+}
+
+std::optional<Bitmap> CanvasElement::read_bitmap(const Element::Rect& area) {
+    if(m_state)
+        send_held(); // what is drawn is read
+    const auto read_id = GempyreUtils::parse<unsigned>(ref().query_id());
+    if(!read_id)
+        return std::nullopt;
+    const auto reply = ref().query<std::vector<std::string>>(m_id, "image_data", {
+        std::to_string(*read_id), std::to_string(area.x), std::to_string(area.y), std::to_string(area.width), std::to_string(area.height)});
+    if(!reply || reply->size() != 5) {
+        GempyreUtils::log(GempyreUtils::LogLevel::Error, "Canvas read failed", m_id);
+        return std::nullopt;
+    }
+    const auto tiles = GempyreUtils::parse<unsigned>((*reply)[0]).value_or(0);
+    const auto width = GempyreUtils::parse<int>((*reply)[3]).value_or(0);
+    const auto height = GempyreUtils::parse<int>((*reply)[4]).value_or(0);
+    Bitmap bitmap(width, height);
+    // tiles are received before the reply, all of them are taken even if one is invalid
+    auto valid = true;
+    for(auto index = 0U; index < tiles; ++index) {
+        const auto tile = ref().take_response(GempyreInternal::binary_key(*read_id, index));
+        if(!valid)
+            continue;
+        if(!tile || !tile->is_binary() || tile->get_binary().size() < ReadHeader * sizeof(dataT)) {
+            GempyreUtils::log(GempyreUtils::LogLevel::Error, "Canvas read tile missing", m_id, index);
+            valid = false;
+            continue;
+        }
+        const auto& bytes = tile->get_binary();
+        dataT header[ReadHeader];
+        std::memcpy(header, bytes.data(), sizeof(header));
+        const auto x = static_cast<int>(header[3]);
+        const auto y = static_cast<int>(header[4]);
+        const auto w = static_cast<int>(header[5]);
+        const auto h = static_cast<int>(header[6]);
+        // client values are checked in a form that does not overflow
+        if(header[0] != CanvasData::versioned(CanvasData::CanvasReadId) || x < 0 || y < 0 || w < 0 || h < 0 ||
+            w > width - x || h > height - y ||
+            bytes.size() != (ReadHeader + static_cast<size_t>(w) * static_cast<size_t>(h)) * sizeof(dataT)) {
+            GempyreUtils::log(GempyreUtils::LogLevel::Error, "Invalid canvas read tile", m_id, index);
+            valid = false;
+            continue;
+        }
+        const auto pixels = bytes.data() + sizeof(header);
+        for(auto j = 0; j < h; ++j)
+            std::memcpy(bitmap.m_canvas->data() + static_cast<size_t>(y + j) * static_cast<size_t>(width) + x,
+                pixels + static_cast<size_t>(j) * static_cast<size_t>(w) * sizeof(dataT), static_cast<size_t>(w) * sizeof(dataT));
+    }
+    if(!valid)
+        return std::nullopt;
+    return bitmap;
+}
+
 void CanvasElement::erase(bool resized) {
     if(resized || m_width <= 0 || m_height <= 0) {
         const auto rv = rect();
@@ -281,7 +896,232 @@ void CanvasElement::erase(bool resized) {
     draw(fc);
 }
 
+void CanvasElement::set_compression(Compression compression) {
+    if(!m_state) {
+        m_state = std::make_shared<CanvasState>();
+    }
+    const auto selected = selected_compression(*m_state);
+    m_state->compression = compression;
+    m_state->controller.set_base(compression);
+    // client may have lossy pixels of cached tiles, or the new codec is lossy
+    if(selected_compression(*m_state) != selected)
+        m_state->forget_sent();
+}
+
+void CanvasElement::set_adaptive_quality(bool enable, const QualityCallback& on_change) {
+    if(!m_state) {
+        m_state = std::make_shared<CanvasState>();
+    }
+    const auto selected = selected_compression(*m_state);
+    m_state->adaptive = enable;
+    m_state->quality_changed = on_change;
+    m_state->controller = QualityController{m_state->compression};
+    if(selected_compression(*m_state) != selected)
+        m_state->forget_sent();
+}
+
+CanvasElement::QualityState CanvasElement::quality_state() const {
+    if(!m_state)
+        return QualityController{}.state();
+    if(!m_state->adaptive)
+        return QualityController{m_state->compression}.state();
+    return m_state->controller.state();
+}
+
+void CanvasElement::set_quality(int quality) {
+    if(!m_state) {
+        m_state = std::make_shared<CanvasState>();
+    }
+    const auto clamped = std::clamp(quality, 1, 100);
+    // cached tiles are resent in the new quality
+    if(clamped != m_state->quality && selected_compression(*m_state) == Compression::Jpeg)
+        m_state->forget_sent();
+    m_state->quality = clamped;
+}
+
+// canvas is modified by other means than tiles, hence sent tiles cannot be trusted
+void CanvasElement::invalidate_tiles() const {
+    if(m_state)
+        m_state->tiles.clear();
+}
+
 void CanvasElement::draw(int x, int y, const Gempyre::Bitmap& bmp) {
-     if(bmp.m_canvas)
-        paint(bmp.m_canvas, x, y, true);
+    const BitmapView view(bmp);
+    if(!view.empty() && !hold(x, y, &view, nullptr, bmp.m_canvas))
+        paint(view, x, y, true);
+}
+
+void CanvasElement::draw(int x, int y, const Gempyre::BitmapView& view) {
+    if(!view.empty() && !hold(x, y, &view, nullptr))
+        paint(view, x, y, true);
+}
+
+void CanvasElement::draw(int x, int y, const Gempyre::IndexedBitmap& bmp) {
+    if(!bmp.empty() && !hold(x, y, nullptr, &bmp))
+        paint(bmp.data(), bmp.width(), bmp.height(), bmp.palette(), x, y, true);
+}
+
+void CanvasElement::on_frame(const FrameCallback& frameCallback) {
+    if(!m_state) {
+        m_state = std::make_shared<CanvasState>();
+    }
+    auto& pacing = m_state->pacing;
+    pacing.callback = frameCallback;
+    pacing.enabled = frameCallback != nullptr;
+    if(!pacing.enabled) {
+        if(pacing.watchdog != 0)
+            ui().cancel_timer(pacing.watchdog);
+        pacing.watchdog = 0;
+        pacing.outstanding = 0;
+        frame_presented(0); // draw what is waiting
+        return;
+    }
+    if(!pacing.subscribed) {
+        pacing.subscribed = true;
+        ref().add_handler(m_id, "canvas_frame", [self = *this](const Event& ev) mutable {
+            const auto it = ev.properties.find("frames");
+            self.frame_presented(it != ev.properties.end() ? GempyreUtils::parse<unsigned>(it->second).value_or(0) : 0);
+        });
+    }
+    if(pacing.watchdog == 0) {
+        // acknowledges are lost if the page is reloaded
+        pacing.watchdog = ui().start_periodic(FrameAckTimeout, [self = *this]() mutable {
+            const auto& state = self.m_state->pacing;
+            if(state.outstanding > 0 && std::chrono::steady_clock::now() - state.sent > FrameAckTimeout) {
+                GempyreUtils::log(GempyreUtils::LogLevel::Warning, "Canvas frame is not acknowledged", self.m_id, state.outstanding);
+                self.frame_presented(state.outstanding);
+            }
+        });
+    }
+    if(pacing.outstanding == 0) {
+        ui().after(0ms, [self = *this]() mutable {
+            self.next_frame();
+        });
+    }
+}
+
+// if the client has not yet presented earlier draws, the draw waits in the returned slot and
+// replaces what was waiting at the same position, otherwise nullptr and the draw is sent
+static CanvasState::Pacing::Held* hold_slot(CanvasState* state, std::string_view id, int x, int y, int width, int height, bool rgba) {
+    if(!state || !state->pacing.enabled)
+        return nullptr;
+    auto& pacing = state->pacing;
+    if(pacing.outstanding == 0 || pacing.in_callback) {
+        ++pacing.outstanding;
+        pacing.sent = std::chrono::steady_clock::now();
+        return nullptr;
+    }
+    const auto same = [&](const CanvasState::Pacing::Held& held) {
+        return held.waiting && held.x == x && held.y == y && (held.canvas != nullptr) == rgba &&
+        (held.canvas ? held.canvas->width() == width && held.canvas->height() == height :
+            held.indexed.width() == width && held.indexed.height() == height);
+    };
+    auto it = std::find_if(pacing.held.begin(), pacing.held.end(), same);
+    if(it == pacing.held.end())
+        it = std::find_if(pacing.held.begin(), pacing.held.end(), [](const auto& held) {return !held.waiting;});
+    if(it == pacing.held.end())
+        it = pacing.held.insert(pacing.held.end(), {false, 0, 0, nullptr, {}});
+    it->waiting = true;
+    it->x = x;
+    it->y = y;
+    if(!rgba)
+        it->canvas.reset();
+    GempyreUtils::log(GempyreUtils::LogLevel::Debug_Trace, "Canvas frame held", id, x, y, width, height);
+    return &*it;
+}
+
+// pixels are the storage of a drawn Bitmap
+bool CanvasElement::hold(int x, int y, const BitmapView* canvas, const IndexedBitmap* indexed, const CanvasDataPtr& pixels) {
+    const auto width = canvas ? canvas->width() : indexed->width();
+    const auto height = canvas ? canvas->height() : indexed->height();
+    const auto it = hold_slot(m_state.get(), m_id, x, y, width, height, canvas != nullptr);
+    if(!it)
+        return false;
+    if(pixels) {
+        it->canvas = pixels; // Bitmap copies the pixels if it is written while they are held
+    } else if(canvas) {
+        // buffer is reused, unless it is shared with a Bitmap
+        if(!it->canvas || it->canvas.use_count() > 1 || it->canvas->width() != width || it->canvas->height() != height)
+            it->canvas = std::make_shared<CanvasData>(width, height);
+        for(auto j = 0; j < height; ++j)
+            std::copy(canvas->row(j), canvas->row(j) + width, it->canvas->data() + j * width);
+    } else {
+        it->indexed = *indexed;
+    }
+    return true;
+}
+
+// gray levels are sent as indices, hence they are expanded in the client
+static const IndexedBitmap::Palette& gray_palette() {
+    static const auto palette = [] {
+        IndexedBitmap::Palette colors{};
+        for(dataT i = 0; i < colors.size(); ++i)
+            colors[i] = Color::rgba(i, i, i);
+        return colors;
+    }();
+    return palette;
+}
+
+void CanvasElement::draw(int x, int y, const Gempyre::GrayBitmap& bmp) {
+    if(bmp.empty())
+        return;
+    if(const auto held = hold_slot(m_state.get(), m_id, x, y, bmp.width(), bmp.height(), false)) {
+        auto& indexed = held->indexed;
+        if(indexed.width() != bmp.width() || indexed.height() != bmp.height())
+            indexed.create(bmp.width(), bmp.height());
+        std::memcpy(indexed.data(), bmp.data(), static_cast<size_t>(bmp.width()) * static_cast<size_t>(bmp.height()));
+        indexed.set_palette(gray_palette());
+        return;
+    }
+    paint(bmp.data(), bmp.width(), bmp.height(), gray_palette(), x, y, true);
+}
+
+// client has presented frames
+void CanvasElement::frame_presented(unsigned frames) {
+    auto& pacing = m_state->pacing;
+    if(frames > 0 && pacing.outstanding > 0)
+        m_state->frame_latency = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - pacing.sent);
+    pacing.outstanding -= std::min(frames, pacing.outstanding);
+    if(pacing.outstanding > 0)
+        return;
+    if(!send_held())
+        next_frame();
+}
+
+// returns false if there was nothing held
+bool CanvasElement::send_held() {
+    auto& pacing = m_state->pacing;
+    bool sent = false;
+    for(auto& held : pacing.held) {
+        if(!held.waiting)
+            continue;
+        held.waiting = false;
+        if(pacing.enabled) {
+            ++pacing.outstanding;
+            pacing.sent = std::chrono::steady_clock::now();
+        }
+        if(held.canvas) {
+            paint(BitmapView(held.canvas->data(), held.canvas->width(), held.canvas->height()), held.x, held.y, true);
+            if(held.canvas.use_count() > 1)
+                held.canvas.reset(); // Bitmap would copy its pixels on the next write
+        } else
+            paint(held.indexed.data(), held.indexed.width(), held.indexed.height(), held.indexed.palette(), held.x, held.y, true);
+        sent = true;
+    }
+    return sent;
+}
+
+void CanvasElement::next_frame() {
+    auto& pacing = m_state->pacing;
+    if(!pacing.callback || pacing.outstanding > 0)
+        return;
+    const auto callback = pacing.callback; // callback may change it
+    pacing.in_callback = true;
+    try {
+        callback();
+    } catch(...) {
+        pacing.in_callback = false;
+        throw;
+    }
+    pacing.in_callback = false;
 }
@@ -0,0 +1,278 @@
+#include "jpeg_encoder.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace Gempyre;
+
+// ITU T.81 Annex K tables
+
+static constexpr uint8_t LumaQuantization[64] = {
+    16, 11, 10, 16, 24, 40, 51, 61,
+    12, 12, 14, 19, 26, 58, 60, 55,
+    14, 13, 16, 24, 40, 57, 69, 56,
+    14, 17, 22, 29, 51, 87, 80, 62,
+    18, 22, 37, 56, 68, 109, 103, 77,
+    24, 35, 55, 64, 81, 104, 113, 92,
+    49, 64, 78, 87, 103, 121, 120, 101,
+    72, 92, 95, 98, 112, 100, 103, 99};
+
+static constexpr uint8_t ChromaQuantization[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99,
+    18, 21, 26, 66, 99, 99, 99, 99,
+    24, 26, 56, 99, 99, 99, 99, 99,
+    47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99};
+
+// natural order index of each zigzag position
+static constexpr uint8_t ZigZag[64] = {
+    0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+static constexpr uint8_t DcLumaBits[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+static constexpr uint8_t DcChromaBits[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+static constexpr uint8_t DcValues[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+static constexpr uint8_t AcLumaBits[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+static constexpr uint8_t AcLumaValues[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa};
+
+static constexpr uint8_t AcChromaBits[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+static constexpr uint8_t AcChromaValues[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa};
+
+namespace {
+struct Tables {
+    std::array<std::array<float, 8>, 8> cosines{}; // [frequency][position], includes normalization
+    std::array<std::array<uint16_t, 256>, 4> codes{};
+    std::array<std::array<uint8_t, 256>, 4> lengths{};
+    Tables() {
+        const auto pi = std::acos(-1.0);
+        for(auto u = 0; u < 8; ++u)
+            for(auto x = 0; x < 8; ++x)
+                cosines[u][x] = static_cast<float>((u == 0 ? std::sqrt(0.125) : 0.5) * std::cos((2 * x + 1) * u * pi / 16));
+        const uint8_t* bits[4] = {DcLumaBits, AcLumaBits, DcChromaBits, AcChromaBits};
+        const uint8_t* values[4] = {DcValues, AcLumaValues, DcValues, AcChromaValues};
+        for(auto t = 0; t < 4; ++t) { // canonical codes
+            unsigned code = 0;
+            auto k = 0;
+            for(auto length = 1; length <= 16; ++length) {
+                for(auto n = 0; n < bits[t][length - 1]; ++n) {
+                    codes[t][values[t][k]] = static_cast<uint16_t>(code++);
+                    lengths[t][values[t][k]] = static_cast<uint8_t>(length);
+                    ++k;
+                }
+                code <<= 1;
+            }
+        }
+    }
+};
+}
+
+static const Tables& tables() {
+    static const Tables t;
+    return t;
+}
+
+static int bit_size(int value) {
+    value = std::abs(value);
+    int size = 0;
+    while(value) {
+        ++size;
+        value >>= 1;
+    }
+    return size;
+}
+
+JpegEncoder::JpegEncoder(int quality) {
+    set_quality(quality);
+}
+
+void JpegEncoder::set_quality(int quality) {
+    m_quality = std::clamp(quality, 1, 100);
+    // scaling as in IJG libjpeg
+    const auto scale = m_quality < 50 ? 5000 / m_quality : 200 - 2 * m_quality;
+    for(auto i = 0; i < 64; ++i) {
+        const auto luma = std::clamp((LumaQuantization[i] * scale + 50) / 100, 1, 255);
+        const auto chroma = std::clamp((ChromaQuantization[i] * scale + 50) / 100, 1, 255);
+        m_luma_div[static_cast<size_t>(i)] = 1.F / static_cast<float>(luma);
+        m_chroma_div[static_cast<size_t>(i)] = 1.F / static_cast<float>(chroma);
+    }
+    for(auto k = 0; k < 64; ++k) {
+        m_luma[static_cast<size_t>(k)] = static_cast<uint8_t>(std::lround(1.F / m_luma_div[ZigZag[k]]));
+        m_chroma[static_cast<size_t>(k)] = static_cast<uint8_t>(std::lround(1.F / m_chroma_div[ZigZag[k]]));
+    }
+}
+
+void JpegEncoder::put_bits(uint32_t bits, int length) {
+    m_bit_buffer = (m_bit_buffer << length) | (bits & ((1U << length) - 1U));
+    m_bit_count += length;
+    while(m_bit_count >= 8) {
+        const auto byte = static_cast<unsigned char>(m_bit_buffer >> (m_bit_count - 8));
+        put_byte(byte);
+        if(byte == 0xFF)
+            put_byte(0); // stuffing
+        m_bit_count -= 8;
+    }
+}
+
+void JpegEncoder::flush_bits() {
+    if(m_bit_count > 0)
+        put_bits(0x7F, 8 - m_bit_count); // padded with ones
+    m_bit_buffer = 0;
+    m_bit_count = 0;
+}
+
+void JpegEncoder::write_headers(int width, int height) {
+    put_word(0xFFD8); // SOI
+    put_word(0xFFDB); // DQT
+    put_word(2 + 2 * 65);
+    put_byte(0);
+    m_out->insert(m_out->end(), m_luma.begin(), m_luma.end());
+    put_byte(1);
+    m_out->insert(m_out->end(), m_chroma.begin(), m_chroma.end());
+    put_word(0xFFC0); // SOF0
+    put_word(8 + 3 * 3);
+    put_byte(8);
+    put_word(static_cast<unsigned>(height));
+    put_word(static_cast<unsigned>(width));
+    put_byte(3);
+    const unsigned char components[] = {1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1}; // id, sampling, table
+    m_out->insert(m_out->end(), std::begin(components), std::end(components));
+    put_word(0xFFC4); // DHT
+    put_word(2 + (17 + 12) * 2 + (17 + 162) * 2);
+    const auto put_table = [this](unsigned char id, const uint8_t* bits, const uint8_t* values, size_t count) {
+        put_byte(id);
+        m_out->insert(m_out->end(), bits, bits + 16);
+        m_out->insert(m_out->end(), values, values + count);
+    };
+    put_table(0x00, DcLumaBits, DcValues, sizeof(DcValues));
+    put_table(0x10, AcLumaBits, AcLumaValues, sizeof(AcLumaValues));
+    put_table(0x01, DcChromaBits, DcValues, sizeof(DcValues));
+    put_table(0x11, AcChromaBits, AcChromaValues, sizeof(AcChromaValues));
+    put_word(0xFFDA); // SOS
+    put_word(6 + 2 * 3);
+    put_byte(3);
+    const unsigned char scan[] = {1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0};
+    m_out->insert(m_out->end(), std::begin(scan), std::end(scan));
+}
+
+void JpegEncoder::encode_block(const Block& block, const std::array<float, 64>& divisors, int& dc,
+    const HuffmanTable& dc_table, const HuffmanTable& ac_table) {
+    const auto& cosines = tables().cosines;
+    // separable DCT, rows then columns
+    Block rows;
+    for(auto y = 0; y < 8; ++y)
+        for(auto u = 0; u < 8; ++u) {
+            float sum = 0;
+            for(auto x = 0; x < 8; ++x)
+                sum += block[static_cast<size_t>(y * 8 + x)] * cosines[static_cast<size_t>(u)][static_cast<size_t>(x)];
+            rows[static_cast<size_t>(y * 8 + u)] = sum;
+        }
+    std::array<int, 64> quantized;
+    for(auto v = 0; v < 8; ++v)
+        for(auto u = 0; u < 8; ++u) {
+            float sum = 0;
+            for(auto y = 0; y < 8; ++y)
+                sum += rows[static_cast<size_t>(y * 8 + u)] * cosines[static_cast<size_t>(v)][static_cast<size_t>(y)];
+            const auto i = static_cast<size_t>(v * 8 + u);
+            quantized[i] = static_cast<int>(std::lround(sum * divisors[i]));
+        }
+
+    const auto put_value = [this](int value, int size) {
+        put_bits(static_cast<uint32_t>(value < 0 ? value + (1 << size) - 1 : value), size);
+    };
+    const auto diff = quantized[0] - dc;
+    dc = quantized[0];
+    const auto dc_size = bit_size(diff);
+    put_code(dc_table[static_cast<size_t>(dc_size)]);
+    if(dc_size > 0)
+        put_value(diff, dc_size);
+    auto run = 0;
+    for(auto k = 1; k < 64; ++k) {
+        const auto value = quantized[ZigZag[k]];
+        if(value == 0) {
+            ++run;
+            continue;
+        }
+        for(; run > 15; run -= 16)
+            put_code(ac_table[0xF0]); // 16 zeros
+        const auto size = bit_size(value);
+        put_code(ac_table[static_cast<size_t>((run << 4) | size)]);
+        put_value(value, size);
+        run = 0;
+    }
+    if(run > 0)
+        put_code(ac_table[0x00]); // end of block
+}
+
+size_t JpegEncoder::encode(const dataT* pixels, int stride, int width, int height, std::vector<unsigned char>& out) {
+    if(width <= 0 || height <= 0 || width > 0xFFFF || height > 0xFFFF)
+        return 0;
+    const auto start = out.size();
+    m_out = &out;
+    write_headers(width, height);
+
+    HuffmanTable huffman[4];
+    for(auto t = 0; t < 4; ++t)
+        for(auto v = 0; v < 256; ++v)
+            huffman[t][static_cast<size_t>(v)] = {tables().codes[static_cast<size_t>(t)][static_cast<size_t>(v)], tables().lengths[static_cast<size_t>(t)][static_cast<size_t>(v)]};
+
+    int dc_y = 0;
+    int dc_cb = 0;
+    int dc_cr = 0;
+    Block y_blocks[4];
+    Block cb_block;
+    Block cr_block;
+    for(auto my = 0; my < height; my += 16) {
+        for(auto mx = 0; mx < width; mx += 16) {
+            cb_block.fill(0);
+            cr_block.fill(0);
+            for(auto j = 0; j < 16; ++j) {
+                const auto row = pixels + static_cast<ptrdiff_t>(std::min(my + j, height - 1)) * stride; // edges are repeated
+                for(auto i = 0; i < 16; ++i) {
+                    const auto pixel = row[std::min(mx + i, width - 1)];
+                    const auto r = static_cast<float>(pixel & 0xFF);
+                    const auto g = static_cast<float>((pixel >> 8) & 0xFF);
+                    const auto b = static_cast<float>((pixel >> 16) & 0xFF);
+                    y_blocks[(j / 8) * 2 + i / 8][static_cast<size_t>((j % 8) * 8 + i % 8)] = 0.299F * r + 0.587F * g + 0.114F * b - 128.F;
+                    const auto c = static_cast<size_t>((j / 2) * 8 + i / 2);
+                    cb_block[c] += 0.25F * (-0.168736F * r - 0.331264F * g + 0.5F * b);
+                    cr_block[c] += 0.25F * (0.5F * r - 0.418688F * g - 0.081312F * b);
+                }
+            }
+            for(const auto& block : y_blocks)
+                encode_block(block, m_luma_div, dc_y, huffman[0], huffman[1]);
+            encode_block(cb_block, m_chroma_div, dc_cb, huffman[2], huffman[3]);
+            encode_block(cr_block, m_chroma_div, dc_cr, huffman[2], huffman[3]);
+        }
+    }
+    flush_bits();
+    put_word(0xFFD9); // EOI
+    m_out = nullptr;
+    return out.size() - start;
+}
@@ -0,0 +1,50 @@
+#ifndef JPEG_ENCODER_H
+#define JPEG_ENCODER_H
+
+#include "gempyre_types.h"
+#include <vector>
+#include <array>
+#include <cstdint>
+
+namespace Gempyre {
+
+// Baseline JPEG encoder for canvas tiles: YCbCr 4:2:0, standard Huffman tables,
+// alpha is ignored. Output is decoded in the browser with createImageBitmap.
+class JpegEncoder {
+public:
+    static constexpr int DefaultQuality = 75;
+    explicit JpegEncoder(int quality = DefaultQuality);
+    // 1 - 100, higher is better and bigger
+    void set_quality(int quality);
+    [[nodiscard]] int quality() const {return m_quality;}
+    // appends JPEG stream into out, returns its size in bytes
+    size_t encode(const dataT* pixels, int stride, int width, int height, std::vector<unsigned char>& out);
+private:
+    struct Code {
+        uint16_t bits;
+        uint8_t length;
+    };
+    using HuffmanTable = std::array<Code, 256>;
+    using Block = std::array<float, 64>;
+    void write_headers(int width, int height);
+    void encode_block(const Block& block, const std::array<float, 64>& divisors, int& dc,
+        const HuffmanTable& dc_table, const HuffmanTable& ac_table);
+    void put_code(const Code& code) {put_bits(code.bits, code.length);}
+    void put_bits(uint32_t bits, int length);
+    void flush_bits();
+    void put_byte(unsigned char byte) {m_out->push_back(byte);}
+    void put_word(unsigned word) {put_byte(static_cast<unsigned char>(word >> 8)); put_byte(static_cast<unsigned char>(word));}
+private:
+    int m_quality{DefaultQuality};
+    std::array<uint8_t, 64> m_luma{};       // quantization tables in zigzag order
+    std::array<uint8_t, 64> m_chroma{};
+    std::array<float, 64> m_luma_div{};     // DCT scaling and quantization, natural order
+    std::array<float, 64> m_chroma_div{};
+    std::vector<unsigned char>* m_out{nullptr};
+    uint32_t m_bit_buffer{0};
+    int m_bit_count{0};
+};
+
+}
+
+#endif // JPEG_ENCODER_H
@@ -0,0 +1,89 @@
+#include "quality_controller.h"
+
+using namespace Gempyre;
+
+QualityController::QualityController(Compression base) :
+    m_base{base},
+    m_state{Level::Full, base, 1, false, 0, 0ms, 0ms, 0, 0, {}} {}
+
+void QualityController::set_base(Compression base) {
+    m_base = base;
+    auto reason = m_state.reason;
+    apply(m_state.level, std::move(reason));
+}
+
+bool QualityController::skip() {
+    if(!m_state.skip_frames)
+        return false;
+    m_skipped = !m_skipped;
+    return m_skipped;
+}
+
+const char* QualityController::pressure(const Sample& sample) const {
+    if(sample.drops > m_drops)
+        return "data dropped";
+    if(sample.backpressure > m_backpressure)
+        return "connection congested";
+    if(sample.queued_bytes > MaxQueuedBytes)
+        return "send queue full";
+    if(sample.latency > MaxLatency)
+        return "send latency";
+    if(sample.outstanding > MaxOutstanding)
+        return "frames not acknowledged";
+    if(sample.frame_latency > MaxFrameLatency)
+        return "frame latency";
+    return nullptr;
+}
+
+bool QualityController::update(const Sample& sample, Clock::time_point now) {
+    m_state.queued_bytes = sample.queued_bytes;
+    m_state.latency = sample.latency;
+    m_state.frame_latency = sample.frame_latency;
+    m_state.backpressure = sample.backpressure;
+    m_state.drops = sample.drops;
+    if(!m_started) {
+        // counters are cumulative, only what happens from now on matters
+        m_started = true;
+        m_backpressure = sample.backpressure;
+        m_drops = sample.drops;
+        m_decided = now;
+        m_calm_since = now;
+        return false;
+    }
+    if(now - m_decided < DecisionInterval)
+        return false;
+    m_decided = now;
+    const auto reason = pressure(sample);
+    m_backpressure = sample.backpressure;
+    m_drops = sample.drops;
+    if(reason) {
+        m_calm_since = now;
+        if(m_state.level == Level::SkipFrames)
+            return false;
+        apply(static_cast<Level>(static_cast<int>(m_state.level) + 1), reason);
+        return true;
+    }
+    if(m_state.level == Level::Full || now - m_calm_since < RestoreDelay)
+        return false;
+    m_calm_since = now;
+    apply(static_cast<Level>(static_cast<int>(m_state.level) - 1), "headroom");
+    return true;
+}
+
+void QualityController::apply(Level level, std::string&& reason) {
+    m_state.level = level;
+    m_state.reason = std::move(reason);
+    switch(level) {
+    case Level::Full:
+        m_state.compression = m_base;
+        break;
+    case Level::Compressed:
+        m_state.compression = m_base == Compression::None || m_base == Compression::Rle ? Compression::Adaptive : m_base;
+        break;
+    default:
+        m_state.compression = Compression::Jpeg;
+        break;
+    }
+    m_state.scale = level >= Level::HalfResolution ? 2 : 1;
+    m_state.skip_frames = level == Level::SkipFrames;
+}
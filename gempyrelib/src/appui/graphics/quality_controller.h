@@ -0,0 +1,55 @@
+#ifndef QUALITY_CONTROLLER_H
+#define QUALITY_CONTROLLER_H
+
+#include "gempyre_graphics.h"
+#include <chrono>
+#include <string>
+
+namespace Gempyre {
+
+// Lowers the quality of canvas data one level at a time when the connection or the UI
+// cannot keep up, and restores it one level at a time when there is headroom again.
+class QualityController {
+public:
+    using Level = CanvasElement::QualityLevel;
+    using Compression = CanvasElement::Compression;
+    using Clock = std::chrono::steady_clock;
+    struct Sample {
+        size_t queued_bytes;
+        unsigned backpressure;  // cumulative
+        unsigned drops;         // cumulative
+        std::chrono::milliseconds latency;
+        unsigned outstanding;   // paced frames not yet acknowledged
+        std::chrono::milliseconds frame_latency;
+    };
+    static constexpr auto DecisionInterval = 250ms;
+    static constexpr auto RestoreDelay = 2s;    // calm needed before each restore step
+    static constexpr size_t MaxQueuedBytes = 4 * 1024 * 1024;
+    static constexpr auto MaxLatency = 100ms;
+    static constexpr auto MaxFrameLatency = 250ms;
+    static constexpr unsigned MaxOutstanding = 3;
+    explicit QualityController(Compression base = Compression::None);
+    // returns true if the level changed
+    bool update(const Sample& sample, Clock::time_point now);
+    // compression that is used on the Full level
+    void set_base(Compression base);
+    [[nodiscard]] const CanvasElement::QualityState& state() const {return m_state;}
+    // called per draw, returns true if the draw is skipped
+    bool skip();
+private:
+    void apply(Level level, std::string&& reason);
+    const char* pressure(const Sample& sample) const;
+private:
+    Compression m_base;
+    CanvasElement::QualityState m_state;
+    bool m_started{false};
+    unsigned m_backpressure{0};
+    unsigned m_drops{0};
+    Clock::time_point m_decided{};
+    Clock::time_point m_calm_since{};
+    bool m_skipped{false};
+};
+
+}
+
+#endif // QUALITY_CONTROLLER_H
@@ -0,0 +1,200 @@
+#include "gempyre_graphics.h"
+#include "gempyre_utils.h"
+#include "gempyre_internal.h"
+#include "canvas_data.h"
+#include "canvas_state.h"
+#include "canvas_protocol.h"
+#include "worker_pool.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace Gempyre;
+
+static uint64_t tile_key(int column, int row) {
+    return (static_cast<uint64_t>(row) << 32) | static_cast<uint32_t>(column);
+}
+
+static Rect tile_rect(const VirtualCanvasState& state, uint64_t key) {
+    const auto x = static_cast<int>(key & 0xFFFFFFFF) * state.tile_size;
+    const auto y = static_cast<int>(key >> 32) * state.tile_size;
+    return {x, y, std::min(state.tile_size, state.width - x), std::min(state.tile_size, state.height - y)};
+}
+
+// the client keeps tiles within one tile from the viewport, so scrolling back and forth does not resend them
+static Rect keep_area(const VirtualCanvasState& state) {
+    const auto& viewport = state.viewport;
+    return {viewport.x - state.tile_size, viewport.y - state.tile_size,
+        viewport.width + 2 * state.tile_size, viewport.height + 2 * state.tile_size};
+}
+
+VirtualCanvas::VirtualCanvas(Ui& ui, const Element& parent, int width, int height, int tile_size)
+    : Element(ui, "div", parent), m_state{std::make_shared<VirtualCanvasState>()} {
+    m_state->width = std::max(0, width);
+    m_state->height = std::max(0, height);
+    m_state->tile_size = std::max(1, tile_size);
+    set_style("overflow", "auto");
+    set_style("position", "relative");
+    ref().send(*this, "virtual_canvas", "handle", m_state->handle,
+        "width", m_state->width,
+        "height", m_state->height,
+        "tile", m_state->tile_size);
+    ref().add_handler(m_id, "virtual_viewport", [self = *this](const Event& ev) mutable {
+        const auto value = [&ev](const char* name) {
+            const auto it = ev.properties.find(name);
+            return it != ev.properties.end() ? GempyreUtils::parse_or<int>(it->second, 0) : 0;
+        };
+        self.m_state->viewport = {value("x"), value("y"), value("width"), value("height")};
+        self.update();
+    });
+}
+
+VirtualCanvas::~VirtualCanvas() {
+}
+
+void VirtualCanvas::set_tile_provider(const TileProvider& provider) {
+    m_state->provider = provider;
+    m_state->sent.clear();
+    update();
+}
+
+void VirtualCanvas::invalidate(const Element::Rect& area) {
+    auto& sent = m_state->sent;
+    for(auto it = sent.begin(); it != sent.end();) {
+        if(intersects(tile_rect(*m_state, *it), area))
+            it = sent.erase(it);
+        else
+            ++it;
+    }
+    update();
+}
+
+void VirtualCanvas::set_compression(CanvasElement::Compression compression) {
+    m_state->compression = compression;
+}
+
+Element::Rect VirtualCanvas::viewport() const {
+    return m_state->viewport;
+}
+
+int VirtualCanvas::width() const {
+    return m_state->width;
+}
+
+int VirtualCanvas::height() const {
+    return m_state->height;
+}
+
+void VirtualCanvas::update() {
+    auto& state = *m_state;
+    const auto generation = ref().binary_generation();
+    if(generation != state.generation) { // client may have missed tiles
+        state.generation = generation;
+        state.sent.clear();
+    }
+    const auto& viewport = state.viewport;
+    if(!state.provider || viewport.width <= 0 || viewport.height <= 0 || state.width <= 0 || state.height <= 0)
+        return;
+
+    // client has evicted the tiles outside of the keep area
+    const auto keep = keep_area(state);
+    auto& sent = state.sent;
+    for(auto it = sent.begin(); it != sent.end();) {
+        if(!intersects(tile_rect(state, *it), keep))
+            it = sent.erase(it);
+        else
+            ++it;
+    }
+
+    const auto tile = state.tile_size;
+    const auto columns = (state.width + tile - 1) / tile;
+    const auto rows = (state.height + tile - 1) / tile;
+    const auto left = std::clamp(viewport.x / tile, 0, columns - 1);
+    const auto top = std::clamp(viewport.y / tile, 0, rows - 1);
+    const auto right = std::clamp((viewport.x + viewport.width - 1) / tile, 0, columns - 1);
+    const auto bottom = std::clamp((viewport.y + viewport.height - 1) / tile, 0, rows - 1);
+    auto& needed = state.needed;
+    needed.clear();
+    for(auto row = top; row <= bottom; ++row) {
+        for(auto column = left; column <= right; ++column) {
+            const auto key = tile_key(column, row);
+            if(sent.find(key) == sent.end()) {
+                needed.push_back(tile_rect(state, key));
+                sent.insert(key);
+            }
+        }
+    }
+    if(needed.empty())
+        return;
+
+    // content is provided in this thread, as the provider is application code
+    auto& bitmaps = state.bitmaps;
+    if(bitmaps.size() < needed.size())
+        bitmaps.resize(needed.size());
+    for(size_t k = 0; k < needed.size(); ++k) {
+        const auto& area = needed[k];
+        if(bitmaps[k].width() != area.width || bitmaps[k].height() != area.height)
+            bitmaps[k].create(area.width, area.height);
+        state.provider(area, bitmaps[k]);
+    }
+    GempyreUtils::log(GempyreUtils::LogLevel::Debug, "Virtual canvas tiles", needed.size(), sent.size());
+
+    // tiles are encoded in parallel, each worker slot has an own encoder
+    auto& workers = WorkerPool::shared();
+    auto& encoders = state.encoders;
+    auto& encoded = state.encoded;
+    auto& payloads = state.payloads;
+    if(encoders.size() < workers.size())
+        encoders.resize(workers.size());
+    encoded.resize(needed.size());
+    payloads.resize(needed.size());
+    workers.run(needed.size(), [&state, &encoders, &encoded, &payloads](size_t begin, size_t end, unsigned slot) {
+        auto& encoder = encoders[slot];
+        encoder.set_compression(state.compression);
+        encoder.clear();
+        for(auto k = begin; k < end; ++k) {
+            const auto& canvas = *state.bitmaps[k].m_canvas;
+            encoded[k] = encoder.encode(canvas.data(), canvas.width(), canvas.width(), canvas.height());
+        }
+        // encoder buffer does not grow anymore
+        for(auto k = begin; k < end; ++k)
+            payloads[k] = encoded[k].codec == TileEncoder::Codec::Raw ? state.bitmaps[k].m_canvas->data() : encoder.data() + encoded[k].offset;
+    });
+
+    // tile records are packed into frames like canvas frames, see CanvasElement::send_tiles
+    auto& offsets = state.offsets;
+    for(size_t first = 0; first < needed.size();) {
+        auto last = first;
+        size_t elements = 0;
+        offsets.clear();
+        do {
+            offsets.push_back(elements);
+            elements += TileRecordHeader + payload_size(encoded[last]);
+            ++last;
+        } while(last < needed.size() && elements + TileRecordHeader + payload_size(encoded[last]) <= FrameMaxElements);
+        auto frame = state.pool.acquire(elements, CanvasData::versioned(CanvasData::VirtualTilesId), CanvasData::NO_ID,
+                            {state.handle, 0, 0,
+                            static_cast<Gempyre::dataT>(state.width),
+                            static_cast<Gempyre::dataT>(state.height),
+                            0});
+        const auto data = frame->data();
+        assert(data + elements == frame->endPtr());
+        workers.run(last - first, [&state, data, first, &offsets](size_t begin, size_t end, unsigned) {
+            for(auto n = begin; n < end; ++n) {
+                const auto k = first + n;
+                const auto& area = state.needed[k];
+                const auto& payload = state.encoded[k];
+                auto trgPos = data + offsets[n];
+                *trgPos++ = static_cast<Gempyre::dataT>(area.x);
+                *trgPos++ = static_cast<Gempyre::dataT>(area.y);
+                *trgPos++ = static_cast<Gempyre::dataT>(area.width);
+                *trgPos++ = static_cast<Gempyre::dataT>(area.height);
+                *trgPos++ = static_cast<Gempyre::dataT>(payload.codec);
+                *trgPos++ = static_cast<Gempyre::dataT>(payload.bytes);
+                const auto source = state.payloads[k];
+                std::copy(source, source + payload_size(payload), trgPos);
+            }
+        });
+        ref().send(std::move(frame), false); // tiles are not resent unless scrolled away, hence not droppable
+        first = last;
+    }
+}
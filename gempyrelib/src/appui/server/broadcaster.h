@@ -9,6 +9,7 @@
 
 
 #include <unordered_map>
+#include <algorithm>
 #include <cassert>
 
 using namespace std::chrono_literals;
@@ -23,6 +24,8 @@ class Broadcaster : public BroadcasterBase {
     static constexpr auto BACKPRESSURE_DELAY = 100ms;
     static constexpr unsigned SEND_SUCCESS = 0xFFFFFFFF;
     enum class SType {Bin, Txt};
+    // socket, data, droppable, group, enqueue time
+    using DataQueue = std::vector<std::tuple<WSSocket*, DataPtr, bool, unsigned, std::chrono::steady_clock::time_point>>;
 
     Broadcaster(const Gempyre::Broadcaster<WSSocket, Loop, WSServer>&) = delete;
     Broadcaster& operator=(const Gempyre::Broadcaster<WSSocket, Loop, WSServer>&) = delete;
@@ -53,13 +56,13 @@ public:
         return !m_sockets.empty();
     }
 
-    bool send_bin(DataPtr&& ptr, bool droppable) override {
+    bool send_bin(DataPtr&& ptr, bool droppable, unsigned group) override {
         GempyreUtils::log(GempyreUtils::LogLevel::Debug, "send bin", ptr->size());
         const std::lock_guard<std::mutex> lock(m_socketMutex);
         for(auto& [s, type] : m_sockets) {
             if(type == TargetSocket::Ui) { // extension is not expected to handle binary messages
                 const auto sz = ptr->size();
-                add_queue(s, std::move(ptr), droppable);
+                add_queue(s, std::move(ptr), droppable, group);
                 socket_send(s, sz);
             }
         }
@@ -71,6 +74,7 @@ public:
         assert(socket);
         const std::lock_guard<std::mutex> lock(m_socketMutex);
         m_sockets.emplace(socket, TargetSocket::Undefined);
+        invalidate(); // new client has nothing
     }
 
     void remove(WSSocket* socket) {
@@ -143,10 +147,40 @@ private:
     }
 
     // see socket_send
-    void add_queue(WSSocket* s, DataPtr&& ptr, bool droppable) {
+    void add_queue(WSSocket* s, DataPtr&& ptr, bool droppable, unsigned group) {
         assert(s);
         std::unique_lock<std::mutex> lock(m_sendBinMutex);
-        m_dataQueue.push_back(std::make_tuple(s, std::move(ptr), droppable));
+        if(droppable && group != 0 && m_droppedGroup == std::make_pair(s, group)) {
+            dropped(); // rest of the group goes too
+            return;
+        }
+        queued(ptr->size());
+        m_dataQueue.push_back(std::make_tuple(s, std::move(ptr), droppable, group, std::chrono::steady_clock::now()));
+    }
+
+    // droppable data is dropped with the rest of its group, returns position of the data that followed it
+    typename DataQueue::iterator drop_unsafe(typename DataQueue::iterator it) {
+        const auto socket = std::get<WSSocket*>(*it);
+        const auto group = std::get<unsigned>(*it);
+        const auto drop = [this](auto& data) {
+            auto& [s, ptr, droppable, g, queued_at] = data;
+            dequeued(ptr->size(), queued_at);
+            ptr.reset();
+        };
+        drop(*it);
+        if(group != 0) {
+            m_droppedGroup = {socket, group};
+            for(auto& data : m_dataQueue) {
+                const auto& [s, ptr, droppable, g, queued_at] = data;
+                if(ptr && droppable && s == socket && g == group)
+                    drop(data);
+            }
+        }
+        dropped();
+        const auto pos = it - m_dataQueue.begin();
+        const auto before = std::count_if(m_dataQueue.begin(), it, [](const auto& data) {return !std::get<DataPtr>(data);});
+        m_dataQueue.erase(std::remove_if(m_dataQueue.begin(), m_dataQueue.end(), [](const auto& data) {return !std::get<DataPtr>(data);}), m_dataQueue.end());
+        return m_dataQueue.begin() + (pos - before);
     }
 
     bool forceReduceData() {
@@ -157,9 +191,8 @@ private:
      bool forceReduceData_unsafe() {
         const auto sz = m_dataQueue.size();
         for(auto it = m_dataQueue.begin(); it != m_dataQueue.end();) {
-            auto& [s, ptr, droppable] = *it;
-            if(droppable) {
-                m_dataQueue.erase(it);
+            if(std::get<bool>(*it)) {
+                it = drop_unsafe(it);
             } else {
                 ++it;
             }   
@@ -184,6 +217,7 @@ private:
             if(target_socket && target_socket != s)
                 continue;
             if(WSServer::has_backpressure(s, txt.size())) {
+                congested();
                 // remove all extra and wait for drain
                 if(!forceReduceData())
                     removeDuplicates_unsafe();
@@ -208,20 +242,24 @@ private:
     void send_bin(WSSocket* target_socket) {
         std::unique_lock<std::mutex> lock(m_sendBinMutex);
         for(auto it = m_dataQueue.begin(); it != m_dataQueue.end();) {
-            auto& [s, ptr, droppable] = *it;
+            auto& [s, ptr, droppable, group, queued_at] = *it;
             if(target_socket && target_socket != s)
                 continue;
             const auto& [data, len] = ptr->payload();
             if(WSServer::has_backpressure(s, len)) {
+                congested();
                 if(droppable)
-                    m_dataQueue.erase(it);
+                    drop_unsafe(it);
                 return;
             }
 
             const auto status = WSServer::send_bin(s, std::string_view{data, len});
                     
             if(status == WSSocket::SendStatus::SUCCESS || !droppable) {
+                dequeued(ptr->size(), queued_at);
                 m_dataQueue.erase(it);
+                if(status != WSSocket::SendStatus::SUCCESS)
+                    dropped();
             } else {
                 if(status != WSSocket::SendStatus::BACKPRESSURE) {
                     m_resendRequest(s, status); // on drops we keep non-droppables and request resend
@@ -241,6 +279,7 @@ private:
     // uws requires send happen in its thread, therefore we queue them and then send them using m_loop->defer
     void socket_send(WSSocket* ws, size_t sz) {
          if(ws && sz > 0 && WSServer::has_backpressure(ws, sz)) {
+            congested();
             std::this_thread::sleep_for(BACKPRESSURE_DELAY);
          }
          assert(m_loop);
@@ -267,7 +306,8 @@ private:
     std::mutex m_sendTxtMutex{};
     std::mutex m_sendBinMutex{};
     std::vector<std::tuple<WSSocket*, std::string>> m_textQueue{};
-    std::vector<std::tuple<WSSocket*, DataPtr, bool>> m_dataQueue{};
+    DataQueue m_dataQueue{};
+    std::pair<WSSocket*, unsigned> m_droppedGroup{nullptr, 0}; // later data of this group is dropped as it comes
     mutable std::mutex m_socketMutex{};
     Loop* m_loop{nullptr};
     };
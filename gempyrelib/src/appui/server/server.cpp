@@ -137,6 +137,13 @@ Server::MessageReply Server::messageHandler(std::string_view message) {
         return MessageReply::DoNothing;
     }
 
+Server::MessageReply Server::binaryHandler(std::string_view message) {
+    GempyreUtils::log(GempyreUtils::LogLevel::Debug, "ServerBin", message.size());
+    const auto bytes = reinterpret_cast<const std::uint8_t*>(message.data());
+    m_onMessage(Object{{"type", "binary"}, {"binary", json::binary(std::vector<std::uint8_t>(bytes, bytes + message.size()))}});
+    return MessageReply::DoNothing;
+}
+
 bool Server::beginBatch() {
     m_batch = std::make_unique<Batch>();
     return true;
@@ -200,11 +207,11 @@ bool Server::send(TargetSocket target, Server::Value&& value, bool batchable) {
     return true;
 }
 
-bool Server::send(Gempyre::DataPtr&& ptr, bool droppable) {
+bool Server::send(Gempyre::DataPtr&& ptr, bool droppable, unsigned group) {
 #ifdef PULL_MODE    
     if(len < WS_MAX_LEN) {
 #endif        
-        if (!broadcaster().send_bin(std::move(ptr), droppable))
+        if (!broadcaster().send_bin(std::move(ptr), droppable, group))
             return false;
 #ifdef PULL_MODE            
     } else {
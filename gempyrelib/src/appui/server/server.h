@@ -11,6 +11,7 @@
 #include <string_view>
 #include <string>
 #include <atomic>
+#include <chrono>
 #include <cassert>
 #include <nlohmann/json.hpp>
 
@@ -29,10 +30,38 @@ enum class TargetSocket{Undefined, Ui, Extension, All};
 
 class BroadcasterBase {
     public:
+    // how well binary data gets through
+    struct Load {
+        size_t queued_bytes;    // binary data waiting to be sent
+        unsigned backpressure;  // times a socket was congested, cumulative
+        unsigned drops;         // droppable data discarded, cumulative
+        std::chrono::milliseconds latency; // how long the latest sent binary data was queued
+    };
     virtual ~BroadcasterBase() = default;
     virtual bool send_text(TargetSocket send_to, std::string&& text) = 0;
-    virtual bool send_bin(DataPtr&& ptr, bool droppable) = 0;
-    virtual void flush() = 0; 
+    // droppable data of the same group (0 is none) is dropped all or nothing
+    virtual bool send_bin(DataPtr&& ptr, bool droppable, unsigned group) = 0;
+    virtual void flush() = 0;
+    // changes when a client may have missed binary data, i.e. data is dropped or a socket is (re)connected
+    unsigned generation() const {return m_generation;}
+    Load load() const {
+        return {m_queued_bytes, m_backpressure, m_drops, std::chrono::milliseconds{m_latency}};
+    }
+protected:
+    void invalidate() {++m_generation;}
+    void queued(size_t bytes) {m_queued_bytes += bytes;}
+    void dequeued(size_t bytes, std::chrono::steady_clock::time_point queued_at) {
+        m_queued_bytes -= bytes;
+        m_latency = static_cast<unsigned>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - queued_at).count());
+    }
+    void congested() {++m_backpressure;}
+    void dropped() {++m_drops; invalidate();}
+private:
+    std::atomic<unsigned> m_generation{0};
+    std::atomic<size_t> m_queued_bytes{0};
+    std::atomic<unsigned> m_backpressure{0};
+    std::atomic<unsigned> m_drops{0};
+    std::atomic<unsigned> m_latency{0};
 };
 
 class Server {
@@ -83,7 +112,7 @@ public:
     bool beginBatch();
     bool endBatch();
     bool send(TargetSocket target, Server::Value&& value, bool batchable = true);
-    bool send(Gempyre::DataPtr&& data, bool droppable);
+    bool send(Gempyre::DataPtr&& data, bool droppable, unsigned group = 0);
 
     static std::string fileToMime(std::string_view filename);
     static std::string notFoundPage(std::string_view url, std::string_view info = "");
@@ -91,6 +120,8 @@ public:
 protected:
     enum class MessageReply {DoNothing, AddUiSocket, AddExtensionSocket};
     MessageReply messageHandler(std::string_view message);
+    // binary message is passed on as a "binary" type object that has the bytes as "binary"
+    MessageReply binaryHandler(std::string_view message);
 #ifdef PULL_MODE      
     enum class DataType{Json, Bin};
     int addPulled(DataType, std::string_view data);
@@ -1,6 +1,7 @@
 #include "gempyre_internal.h"
 #include "gempyre.js.h"
 #include "data.h"
+#include <cstring>
 
 using namespace Gempyre;
 
@@ -295,6 +296,16 @@ GempyreInternal& Ui::ref() {
                 auto id = params.at("query_id");
                 auto k = params.at(key);
                 push_response(std::move(id), std::move(k));
+            } else if(type == "binary") {
+                auto& binary = params.at("binary");
+                const auto& bytes = binary.get_binary();
+                if(bytes.size() >= 3 * sizeof(dataT)) {
+                    dataT words[3];
+                    std::memcpy(words, bytes.data(), sizeof(words));
+                    push_response(binary_key(words[1], words[2]), std::move(binary));
+                } else {
+                    GempyreUtils::log(GempyreUtils::LogLevel::Error, "Invalid binary message", bytes.size());
+                }
             } else if(type == "extension_response") {
                 gempyre_utils_assert_x(containsAll(keys(params), {"extension_id", "extension_call"}), "extension_response invalid parameters");
                 auto id = params.at("extension_id");
@@ -602,14 +613,14 @@ void GempyreInternal::shoot_requests() {
     }
 }
 
-void GempyreInternal::send(const DataPtr& data, bool droppable) {
-    auto clonedBytes = data->clone();
-    GempyreUtils::log(GempyreUtils::LogLevel::Debug, "send ui_bin", clonedBytes->size());
-    add_request([this, clonedBytes = std::move(clonedBytes), droppable]() mutable {
+void GempyreInternal::send(DataPtr&& data, bool droppable, unsigned group) {
+    GempyreUtils::log(GempyreUtils::LogLevel::Debug, "send ui_bin", data->size());
+    // data is not copied, the caller shall not modify it anymore
+    add_request([this, data = std::move(data), droppable, group]() mutable {
         #ifdef ENSURE_SEND
-            const auto sz = clonedBytes->size();
+            const auto sz = data->size();
         #endif
-        const auto ok = m_server->send(std::move(clonedBytes), droppable);
+        const auto ok = m_server->send(std::move(data), droppable, group);
         #ifdef ENSURE_SEND
         if(ok && !droppable && sz >= ENSURE_SEND) {           //For some reason the DataPtr MAY not be send (propability high on my mac), but his cludge seems to fix it
             send(m_app_ui->root(), "nil", "");     //correct fix may be adjust buffers and or send Data in several smaller packets .i.e. in case of canvas as
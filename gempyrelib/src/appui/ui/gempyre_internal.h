@@ -119,7 +119,7 @@ public:
 
     bool eventLoop(bool is_main, const std::chrono::milliseconds& await = std::chrono::milliseconds::max());
 
-    void send(const DataPtr& data, bool droppable);
+    void send(DataPtr&& data, bool droppable, unsigned group = 0);
 
     template<typename T>
     void send_unique(const Element& el, std::string_view type, const T& value) {
@@ -211,6 +211,16 @@ public:
         return is_connected() && is_running() && m_server->isUiReady();
     }
 
+    // @see BroadcasterBase::generation
+    unsigned binary_generation() const {
+        return has_server() ? m_server->broadcaster().generation() : 0;
+    }
+
+    // @see BroadcasterBase::load
+    BroadcasterBase::Load binary_load() const {
+        return has_server() ? m_server->broadcaster().load() : BroadcasterBase::Load{0, 0, 0, std::chrono::milliseconds{0}};
+    }
+
 
     void add_handler(const std::string& id, const std::string& name, const Element::SubscribeFunction& handler) {
         HandlerFunction hf = [handler](const Event& event) {
@@ -270,6 +280,11 @@ public:
          m_responsemap.push(std::move(id), std::move(response));
     }
 
+    // binary response starts with words: type, id, index - and is taken with this key
+    static std::string binary_key(unsigned id, unsigned index) {
+        return std::to_string(id) + '.' + std::to_string(index);
+    }
+
     void call_error(const std::string& src, std::string err) {
         if(m_onError) {
                 m_onError(src, err);
@@ -1,6 +1,7 @@
 #include "data.h"
 #include "gempyre_utils.h"
 #include <cassert>
+#include <atomic>
 
 using namespace Gempyre;
 
@@ -13,19 +14,8 @@ static unsigned g_index_couter = 0;
 
 
 Data::Data(size_t sz, dataT type, std::string_view owner, const std::vector<dataT>& header) :
-    m_data(sz + (fixedDataSize + header.size()) + align(owner.size())), m_index(g_index_couter++) {
-        m_data[0] = type;
-        m_data[1] = static_cast<dataT>(sz);
-        m_data[2] = align(static_cast<dataT>(owner.size()));
-        m_data[3] = static_cast<dataT>(header.size());
-        std::copy(header.begin(), header.end(), endPtr());
-        auto idData = reinterpret_cast<uint16_t*>(endPtr() + header.size());
-
-        const auto owner_size = align(owner.size());
-        for(auto i = 0U; i < owner_size; i++) {
-            const auto c = i < owner.size() ?  owner[i] : 0; // todo better and handle endianness
-            idData[i] = static_cast<uint16_t>(c);
-        }
+    m_data(new dataT[required(sz, owner, header.size())]()), m_capacity{required(sz, owner, header.size())} {
+        layout(sz, type, owner, header.data(), header.size());
         assert(header.size() == 5);
 /*#ifdef GEMPYRE_IS_DEBUG
         GempyreUtils::log(GempyreUtils::LogLevel::Debug, "send-data_buffer", owner,
@@ -33,6 +23,34 @@ Data::Data(size_t sz, dataT type, std::string_view owner, const std::vector<data
 #endif*/          
 }
 
+// not initialized, DataPool writes all
+Data::Data(size_t capacity) : m_data(new dataT[capacity]), m_capacity{capacity} {}
+
+size_t Data::required(size_t sz, std::string_view owner, size_t header_size) {
+    return sz + (fixedDataSize + header_size) + align(owner.size());
+}
+
+void Data::layout(size_t sz, dataT type, std::string_view owner, const dataT* header, size_t header_size) {
+    m_size = required(sz, owner, header_size);
+    assert(m_size <= m_capacity);
+    m_index = g_index_couter++;
+    m_data[0] = type;
+    m_data[1] = static_cast<dataT>(sz);
+    m_data[2] = align(static_cast<dataT>(owner.size()));
+    m_data[3] = static_cast<dataT>(header_size);
+    std::copy(header, header + header_size, endPtr());
+    auto idData = reinterpret_cast<uint16_t*>(endPtr() + header_size);
+
+    const auto owner_size = align(owner.size());
+    for(auto i = 0U; i < owner_size; i++) {
+        const auto c = i < owner.size() ?  owner[i] : 0; // todo better and handle endianness
+        idData[i] = static_cast<uint16_t>(c);
+    }
+    // rest of the padding
+    const auto idEnd = reinterpret_cast<dataT*>(idData + owner_size);
+    std::fill(idEnd, m_data.get() + m_size, 0);
+}
+
 std::string Data::owner() const {
     std::string out;
     const auto pos = reinterpret_cast<const uint16_t*>(endPtr() + m_data[3]);
@@ -55,21 +73,21 @@ std::vector<Gempyre::dataT> Data::header() const {
     return out;
 }
 
-void Data::writeHeader(const std::vector<dataT>& header) {
+void Data::writeHeader(std::initializer_list<dataT> header) {
      gempyre_utils_assert_x(header.size() == m_data[3], "Header sizes must match!");
-     std::copy(header.begin(), header.end(), end());
+     std::copy(header.begin(), header.end(), endPtr());
 }
 
 std::tuple<const char*, size_t> Data::payload() const {
-    return {reinterpret_cast<const char*>(m_data.data()), size()};
+    return {reinterpret_cast<const char*>(m_data.get()), size()};
 }
 
 dataT* Data::data() {
-    return &m_data.data()[fixedDataSize];
+    return &m_data[fixedDataSize];
 }
 
 const dataT* Data::data() const {
-    return &m_data.data()[fixedDataSize];
+    return &m_data[fixedDataSize];
 }
 
 unsigned Data::elements() const {
@@ -82,6 +100,35 @@ DataPtr Data::clone() const {
     return ptr;
 }
 
+DataPtr DataPool::acquire(size_t sz, dataT type, std::string_view owner, std::initializer_list<dataT> header) {
+    const auto needed = Data::required(sz, owner, header.size());
+    DataPtr* best = nullptr;
+    DataPtr* free = nullptr;
+    for(auto& buffer : m_buffers) {
+        if(buffer.use_count() != 1) // still in use e.g. in send queue
+            continue;
+        free = &buffer;
+        if(buffer->capacity() >= needed && (!best || buffer->capacity() < (*best)->capacity()))
+            best = &buffer;
+    }
+    // buffer was released in an other thread
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(!best) {
+        ++m_allocations;
+        auto buffer = std::shared_ptr<Data>(new Data(needed));
+        if(free)                            // too small, replace
+            *free = std::move(buffer);
+        else if(m_buffers.size() < m_max)
+            m_buffers.push_back(std::move(buffer));
+        else {                              // all in use, not pooled 
+            buffer->layout(sz, type, owner, header.begin(), header.size());
+            return buffer;
+        }
+        best = free ? free : &m_buffers.back();
+    }
+    (*best)->layout(sz, type, owner, header.begin(), header.size());
+    return *best;
+}
 
 #ifdef GEMPYRE_IS_DEBUG
         std::string Data::dump() const {
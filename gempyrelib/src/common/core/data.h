@@ -4,6 +4,8 @@
 #include <string> 
 #include <iterator>
 #include <vector>
+#include <memory>
+#include <initializer_list>
 #include <string_view>
 #include <gempyre_types.h>
 
@@ -45,24 +47,48 @@ class Data {
         [[nodiscard]] dataT operator[](int index) const {return (data()[index]);}
         [[nodiscard]] dataT* endPtr() {return data() + elements();}
         [[nodiscard]] const dataT* endPtr() const {return data() + elements();}
-        void writeHeader(const std::vector<dataT>& header);
+        void writeHeader(std::initializer_list<dataT> header);
         [[nodiscard]] std::vector<dataT> header() const;
         [[nodiscard]] std::string owner() const;
         [[nodiscard]] DataPtr clone() const;
-        [[nodiscard]] size_t size() const {return m_data.size() * sizeof(dataT);}
+        [[nodiscard]] size_t size() const {return m_size * sizeof(dataT);}
+        [[nodiscard]] size_t capacity() const {return m_capacity;}
         [[nodiscard]] bool has_owner() const;
         [[nodiscard]] auto index() const {return m_index;}
         virtual ~Data() = default;
         Data(size_t sz, dataT type, std::string_view owner, const std::vector<dataT>& header);
         std::tuple<const char*, size_t> payload() const; // char* ?? todo
+        [[nodiscard]] static size_t required(size_t sz, std::string_view owner, size_t header_size);
 #ifdef GEMPYRE_IS_DEBUG
         std::string dump() const;
 #endif
     private:
-        std::vector<dataT> m_data;
-        const unsigned m_index;
+        explicit Data(size_t capacity); // uninitialized, @see DataPool
+        void layout(size_t sz, dataT type, std::string_view owner, const dataT* header, size_t header_size);
+    private:
+        std::unique_ptr<dataT[]> m_data;
+        size_t m_capacity{0};
+        size_t m_size{0};
+        unsigned m_index{0};
         friend class Element;
         friend class Ui;
+        friend class DataPool;
+    };
+
+    /// Recycles Data buffers that are not referenced elsewhere anymore, e.g. the broadcaster
+    /// has sent and released them. Buffers are not initialized, the caller shall write all the data.
+    /// Not thread safe, but buffers can be released in any thread.
+    class DataPool {
+    public:
+        explicit DataPool(size_t max_buffers = 16) : m_max{max_buffers} {}
+        [[nodiscard]] DataPtr acquire(size_t sz, dataT type, std::string_view owner, std::initializer_list<dataT> header);
+        /// number of buffer allocations done, in steady state this should not grow.
+        [[nodiscard]] unsigned allocations() const {return m_allocations;}
+        [[nodiscard]] size_t size() const {return m_buffers.size();}
+    private:
+        std::vector<DataPtr> m_buffers{};
+        const size_t m_max;
+        unsigned m_allocations{0};
     };
 }
 
@@ -2,10 +2,13 @@
 #include "gempyre_utils.h"
 #include "data.h"
 #include "canvas_data.h"
+#include "blend.h"
 #include <string>
-#include <lodepng.h>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <optional>
+#include <vector>
 
 
 using namespace Gempyre;
@@ -98,30 +101,6 @@ Bitmap::Bitmap(int width, int height, Gempyre::Color::type color) : Bitmap(width
         draw_rect({0, 0, width, height}, color);
 }
 
-Bitmap::Bitmap(const std::vector<unsigned char>& image_data)  {
-    unsigned width, height;
-    std::vector<unsigned char> image;
-    const auto error = lodepng::decode(image, width, height, image_data, LCT_RGBA, 8);
-
-    if(error) {
-        throw std::runtime_error(lodepng_error_text(error)); // or use return value as exceptions not used? TODO: Think
-        }
-
-    create(static_cast<int>(width), static_cast<int>(height));
-    assert(m_canvas);
-    auto ptr = reinterpret_cast<unsigned char*>(m_canvas->data());
-    std::copy(image.begin(), image.end(), ptr);    
-}
-
-std::vector<uint8_t> Bitmap::png_image() const {
-    std::vector<uint8_t> out;
-    lodepng::State state;
-    lodepng::encode(out, reinterpret_cast<const unsigned char*>(m_canvas->data()),
-        static_cast<unsigned>(width()),
-        static_cast<unsigned>(height()), state);
-    return out;
-}
-
 void Bitmap::create(int width, int height) {
         assert(width > 0);
         assert(height > 0);
@@ -144,6 +123,7 @@ Bitmap::~Bitmap() {
 void Bitmap::draw_rect(const Gempyre::Rect& rect, Color::type color) {
     if(empty())
         return;
+    detach();
     const auto x = std::max(0, rect.x);
     const auto y = std::max(0, rect.y);
     const auto width = (x + rect.width >= m_canvas->width()) ?  m_canvas->width ()- rect.x : rect.width;
@@ -164,7 +144,7 @@ void Bitmap::tile(int x_pos, int y_pos, const Bitmap& bitmap) {
 }
 
 void Bitmap::tile(int x_pos, int y_pos, const Bitmap& bitmap, int rx_pos, int ry_pos, int r_width, int r_height) {
-    if(bitmap.m_canvas == m_canvas)
+    if(&bitmap == this)
         return;
 
     if(empty() || bitmap.empty())
@@ -173,136 +153,167 @@ void Bitmap::tile(int x_pos, int y_pos, const Bitmap& bitmap, int rx_pos, int ry
     rx_pos = std::max(0, rx_pos);
     ry_pos = std::max(0, ry_pos);
 
-    auto width = std::min(r_width, bitmap.width() - rx_pos);
-    auto height = std::min(r_height, bitmap.height() - ry_pos);
+    const auto width = std::min(r_width, bitmap.width() - rx_pos);
+    const auto height = std::min(r_height, bitmap.height() - ry_pos);
 
-    if (width <= 0 || x_pos >= this->width() || x_pos + width < 0)
+    if (width <= 0 || height <= 0)
         return;
 
-    if (height <= 0 || y_pos >= this->height() || y_pos + height < 0)
-        return;
+    tile(x_pos, y_pos, BitmapView(bitmap.m_canvas->data() + rx_pos + ry_pos * bitmap.width(), width, height, bitmap.width()));
+}
+
+// area of this bitmap that a bitmap drawn at x_pos, y_pos covers, and where it is in that bitmap
+struct Overlap {
+    int x;
+    int y;
+    int b_x;
+    int b_y;
+    int width;
+    int height;
+};
+
+static std::optional<Overlap> overlap(int target_width, int target_height, int x_pos, int y_pos, int source_width, int source_height) {
+    auto width = source_width;
+    auto height = source_height;
+        
+    if (x_pos >= target_width || x_pos + source_width < 0)
+        return std::nullopt;
+
+    if (y_pos >= target_height || y_pos + source_height < 0)
+        return std::nullopt;
         
     int x, y, b_x, b_y;
 
-    if (x_pos < 0) {                // if -10 and width 100
-        x = 0;                      // set 0  
-        b_x = -x_pos + rx_pos;      // (-10) => 10
-        width += x_pos;               // 100 + (-10) => 90 
+    if (x_pos < 0) {              // if -10 and width 100
+        x = 0;                  // set 0  
+        b_x = (-x_pos);// (-10) => 10
+        width -= b_x;           // 100 + (-10) => 90 
     } else {
         x = x_pos;
-        b_x = rx_pos;
+        b_x = 0;
     }
 
     if (y_pos < 0) {
         y = 0;
-        b_y = -y_pos + ry_pos;
-        height += y_pos;
+        b_y = (-y_pos);
+        height -= b_y;
     } else {
         y = y_pos;
-        b_y = ry_pos;
+        b_y = 0;
     }
 
-    if  (x + width >= this->width()) {
-        width = this->width() - x;
+    if  (x + width >= target_width) {
+        width = target_width - x;
     }
 
-    if  (y + height >= this->height()) {
-        height = this->height() - y;
+    if  (y + height >= target_height) {
+        height = target_height - y;
     }
 
-    assert(width <= this->width());
-    assert(height <= this->height());
-    assert(width <= bitmap.width());
-    assert(height <= bitmap.height());
-   
+    assert(width <= target_width);
+    assert(height <= target_height);
+    assert(width <= source_width);
+    assert(height <= source_height);
+    return Overlap{x, y, b_x, b_y, width, height};
+}
 
-    for (auto j = 0; j < height; ++j) {
-        const auto target = m_canvas->data() + (x + (y + j) * m_canvas->width());
-        const auto source = bitmap.m_canvas->data() + (b_x + (b_y + j) * bitmap.m_canvas->width());
-        std::memcpy(target, source, sizeof(dataT) * static_cast<size_t>(width));
-        }
+void Bitmap::tile(int x_pos, int y_pos, const BitmapView& view) {
+    if(empty() || view.empty())
+        return;
+
+    const auto area = overlap(width(), height(), x_pos, y_pos, view.width(), view.height());
+    if(!area || area->width <= 0)
+        return;
+    detach();
+
+    for (auto j = 0; j < area->height; ++j) {
+        const auto target = m_canvas->data() + (area->x + (area->y + j) * m_canvas->width());
+        const auto source = view.row(area->b_y + j) + area->b_x;
+        std::memcpy(target, source, sizeof(dataT) * static_cast<size_t>(area->width));
+    }
 }
 
 void Bitmap::merge( int x_pos, int y_pos, const Bitmap& bitmap) {
-    if(bitmap.m_canvas == m_canvas)
+    if(&bitmap == this)
         return;
+    merge(x_pos, y_pos, BitmapView(bitmap));
+}
 
-    if(empty() || bitmap.empty())
+void Bitmap::merge(int x_pos, int y_pos, const BitmapView& view) {
+    if(empty() || view.empty())
         return;    
 
-    auto width = bitmap.width();
-    auto height = bitmap.height();
-        
-    if (x_pos >= this->width() || x_pos + bitmap.width() < 0)
+    const auto area = overlap(width(), height(), x_pos, y_pos, view.width(), view.height());
+    if(!area || area->width <= 0)
         return;
+    detach();
 
-    if (y_pos >= this->height() || y_pos + bitmap.height() < 0)
-            return;
-        
-    int x, y, b_x, b_y;
-
-    if (x_pos < 0) {              // if -10 and width 100
-        x = 0;                  // set 0  
-        b_x = (-x_pos);// (-10) => 10
-        width -= b_x;           // 100 + (-10) => 90 
-    } else {
-        x = x_pos;
-        b_x = 0;
-    }
-
-    if (y_pos < 0) {
-        y = 0;
-        b_y = (-y_pos);
-        height -= b_y;
-    } else {
-        y = y_pos;
-        b_y = 0;
+    for (auto j = 0; j < area->height; ++j) {
+        const auto target = m_canvas->data() + (area->x + (area->y + j) * m_canvas->width());
+        const auto source = view.row(area->b_y + j) + area->b_x;
+        merge_row(source, target, static_cast<size_t>(area->width));
     }
+}
 
-    if  (x + width >= this->width()) {
-        width = this->width() - x;
-    }
+void Bitmap::blend(int x_pos, int y_pos, const Bitmap& bitmap, BlendMode mode, bool premultiplied) {
+    if(&bitmap == this)
+        return;
+    blend(x_pos, y_pos, BitmapView(bitmap), mode, premultiplied);
+}
 
-    if  (y + height >= this->height()) {
-        height = this->height() - y;
-    }
+void Bitmap::blend(int x_pos, int y_pos, const BitmapView& view, BlendMode mode, bool premultiplied) {
+    // target is kept as is, not even converted to premultiplied and back, that would lose precision
+    if(empty() || view.empty() || mode == BlendMode::Destination)
+        return;    
 
-    assert(width <= this->width());
-    assert(height <= this->height());
-    assert(width <= bitmap.width());
-    assert(height <= bitmap.height());
-   
-
-    for (auto j = 0; j < height; ++j) {
-        for (auto i = 0; i < width; ++i) {
-            assert(x + i < this->width());
-            assert(y + j < this->height());
-            const auto p = m_canvas->get(x + i, y + j);
-
-            const auto po = bitmap.m_canvas->get(b_x + i, b_y + j);
-            const auto ao = Color::alpha(po);
-            const auto a = Color::alpha(p);
-            
-            const auto r = Color::r(p) * (0xFF - ao);
-            const auto g = Color::g(p) * (0xFF - ao);
-            const auto b = Color::b(p) * (0xFF - ao);
-
-            const auto ro = (Color::r(po) * ao);
-            const auto go = (Color::g(po) * ao);
-            const auto bo = (Color::b(po) * ao);
-
-            const auto pix = Color::rgba_clamped((r + ro) / 0xFF , (g + go) / 0xFF, (b + bo) / 0xFF, a + ao);
-            m_canvas->put(x + i, y + j, pix);
+    const auto area = overlap(width(), height(), x_pos, y_pos, view.width(), view.height());
+    if(!area || area->width <= 0)
+        return;
+    detach();
+
+    const auto width = static_cast<size_t>(area->width);
+    std::vector<dataT> row; // straight alpha source is premultiplied a row at time
+    if(!premultiplied)
+        row.resize(width);
+
+    for (auto j = 0; j < area->height; ++j) {
+        const auto target = m_canvas->data() + (area->x + (area->y + j) * m_canvas->width());
+        const auto source = view.row(area->b_y + j) + area->b_x;
+        if(premultiplied) {
+            blend_row(mode, source, target, width);
+        } else {
+            premultiply_row(source, row.data(), width);
+            premultiply_row(target, target, width);
+            blend_row(mode, row.data(), target, width);
+            unpremultiply_row(target, width);
         }
     }
 }
 
+void Bitmap::premultiply() {
+    if(empty())
+        return;
+    detach();
+    const auto pixels = static_cast<size_t>(width()) * static_cast<size_t>(height());
+    premultiply_row(m_canvas->data(), m_canvas->data(), pixels);
+}
+
+void Bitmap::unpremultiply() {
+    if(empty())
+        return;
+    detach();
+    const auto pixels = static_cast<size_t>(width()) * static_cast<size_t>(height());
+    unpremultiply_row(m_canvas->data(), pixels);
+}
+
 
 void Bitmap::set_pixel(int x, int y, Color::type color) {
+    detach();
     m_canvas->put(x, y, color);
     }
 
 void Bitmap::set_alpha(int x, int y, Color::type alpha) {
+    detach();
     const auto c = m_canvas->get(x, y);
     m_canvas->put(x, y, pix(Color::r(c), Color::g(c), Color::b(c), alpha));
     }
@@ -311,6 +322,54 @@ void Bitmap::set_alpha(int x, int y, Color::type alpha) {
     return m_canvas->get(x, y);
   }   
 
+PixelSpan<Color::type> Bitmap::row(int y) {
+    if(empty() || y < 0 || y >= height())
+        return {};
+    return {inner_data() + static_cast<ptrdiff_t>(y) * width(), static_cast<size_t>(width())};
+}
+
+PixelSpan<const Color::type> Bitmap::const_row(int y) const {
+    if(empty() || y < 0 || y >= height())
+        return {};
+    return {m_canvas->data() + static_cast<ptrdiff_t>(y) * width(), static_cast<size_t>(width())};
+}
+
+PixelRows<Color::type> Bitmap::rows() {
+    if(empty())
+        return {};
+    return {inner_data(), width(), height(), width()};
+}
+
+PixelRows<const Color::type> Bitmap::const_rows() const {
+    if(empty())
+        return {};
+    const auto& canvas = *m_canvas;
+    return {canvas.data(), width(), height(), width()};
+}
+
+// clipped in 64 bits, as x + count may overflow
+static std::pair<int64_t, int64_t> clip_row(int x, int count, int width) {
+    return {std::max<int64_t>(x, 0), std::min<int64_t>(static_cast<int64_t>(x) + count, width)};
+}
+
+void Bitmap::fill_row(int x, int y, int count, Color::type color) {
+    const auto [first, last] = clip_row(x, count, width());
+    if(first >= last || y < 0 || y >= height())
+        return;
+    const auto span = row(y).subspan(static_cast<size_t>(first), static_cast<size_t>(last - first));
+    std::fill(span.begin(), span.end(), color);
+}
+
+void Bitmap::copy_row(int x, int y, const Color::type* pixels, int count) {
+    if(!pixels)
+        return;
+    const auto [first, last] = clip_row(x, count, width());
+    if(first >= last || y < 0 || y >= height())
+        return;
+    const auto span = row(y).subspan(static_cast<size_t>(first), static_cast<size_t>(last - first));
+    std::memcpy(span.data(), pixels + (first - x), span.size() * sizeof(Color::type));
+}
+
 
 // add this test in bitmap was long thinking - yes it may make it slower
 // but makes many things easier elsewhere (no need to call empty)
@@ -347,16 +406,37 @@ void Bitmap::copy_from(const Bitmap& other) {
 }
 
 Bitmap Bitmap::clip(const Gempyre::Rect& rect) const {
-    const auto x = std::max(0, rect.x);
-    const auto y = std::max(0, rect.y);
-    const auto w = std::min(rect.width - (x - rect.x), width() - x);
-    const auto h = std::min(rect.height - (y - rect.y), height() - y);
-    Bitmap bmp(w, h);
-    for (auto row = 0; row < h; ++row) {
-        for(auto col = 0; col < w; ++col) {
-            bmp.set_pixel(col, row, pixel(col + x, row + y)); // this could be a scanline copy, but really? show me the benefit
-        }
-    }
+    return BitmapView(*this, rect).to_bitmap();
+}
+
+BitmapView::BitmapView(const Color::type* pixels, int width, int height, int stride) :
+    m_pixels{pixels},
+    m_width{std::max(0, width)},
+    m_height{std::max(0, height)},
+    m_stride{stride > 0 ? stride : std::max(0, width)} {
+}
+
+BitmapView::BitmapView(const Bitmap& bitmap) :
+    BitmapView(bitmap.empty() ? nullptr : reinterpret_cast<const Color::type*>(bitmap.const_data()), bitmap.width(), bitmap.height()) {
+}
+
+BitmapView::BitmapView(const Bitmap& bitmap, const Gempyre::Rect& rect) :
+    BitmapView(BitmapView(bitmap).view(rect)) {
+}
+
+BitmapView BitmapView::view(const Gempyre::Rect& rect) const {
+    const auto x = std::clamp(rect.x, 0, m_width);
+    const auto y = std::clamp(rect.y, 0, m_height);
+    const auto w = std::min(rect.width - (x - rect.x), m_width - x);
+    const auto h = std::min(rect.height - (y - rect.y), m_height - y);
+    if(empty() || w <= 0 || h <= 0)
+        return BitmapView{};
+    return BitmapView(row(y) + x, w, h, m_stride);
+}
+
+Bitmap BitmapView::to_bitmap() const {
+    Bitmap bmp(m_width, m_height);
+    bmp.tile(0, 0, *this);
     return bmp;
 }
 
@@ -369,9 +449,44 @@ const uint8_t* Bitmap::const_data() const {
 }
 
 Color::type* Bitmap::inner_data() {
+    detach();
     return m_canvas->data();
 }
 
+// copy-on-write, copies share the pixels until one of them is written
+void Bitmap::detach() {
+    if(m_canvas && m_canvas.use_count() > 1)
+        *this = clone();
+}
+
 std::size_t Bitmap::size() const {
     return m_canvas->size();
-}
\ No newline at end of file
+}
+
+IndexedBitmap::IndexedBitmap(int width, int height) {
+    if(width > 0 && height > 0)
+        create(width, height);
+}
+
+IndexedBitmap::IndexedBitmap(int width, int height, const Palette& palette) : IndexedBitmap(width, height) {
+    m_palette = palette;
+}
+
+void IndexedBitmap::create(int width, int height) {
+    assert(width > 0);
+    assert(height > 0);
+    m_data.assign(static_cast<size_t>(width) * static_cast<size_t>(height), 0);
+    m_width = width;
+    m_height = height;
+}
+
+Bitmap IndexedBitmap::to_bitmap() const {
+    Bitmap bmp;
+    if(empty())
+        return bmp;
+    bmp.create(m_width, m_height);
+    std::transform(m_data.begin(), m_data.end(), bmp.inner_data(), [this](auto index) {
+        return m_palette[index];
+    });
+    return bmp;
+}
@@ -0,0 +1,277 @@
+#include "blend.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GEMPYRE_BLEND_SIMD
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GEMPYRE_BLEND_SIMD
+#endif
+
+using namespace Gempyre;
+
+// Kernels work on components widened to 16 bits, a product of two components fits there.
+// Each backend provides the same operations, the kernels are written once for all of them.
+
+namespace {
+
+// one pixel at time, also the tail of vectorized rows
+struct Scalar {
+    using Wide = std::array<uint32_t, 4>;
+    static constexpr size_t Pixels = 1;
+    static Wide widen(dataT pixel) {
+        return {pixel & 0xFF, (pixel >> 8) & 0xFF, (pixel >> 16) & 0xFF, pixel >> 24};
+    }
+    static dataT narrow(const Wide& w) {
+        return std::min(w[0], 0xFFU) | (std::min(w[1], 0xFFU) << 8) | (std::min(w[2], 0xFFU) << 16) | (std::min(w[3], 0xFFU) << 24);
+    }
+    template<class F>
+    static Wide each(const Wide& a, const Wide& b, F f) {
+        return {f(a[0], b[0]), f(a[1], b[1]), f(a[2], b[2]), f(a[3], b[3])};
+    }
+    static Wide set(uint32_t v) {return {v, v, v, v};}
+    static Wide alpha(const Wide& w) {return set(w[3]);}
+    static Wide mul(const Wide& a, const Wide& b) {return each(a, b, [](auto x, auto y) {return x * y;});}
+    static Wide add(const Wide& a, const Wide& b) {return each(a, b, [](auto x, auto y) {return x + y;});}
+    static Wide adds(const Wide& a, const Wide& b) {return each(a, b, [](auto x, auto y) {return std::min(x + y, 0xFFFFU);});}
+    static Wide sub(const Wide& a, const Wide& b) {return each(a, b, [](auto x, auto y) {return x - y;});}
+    static Wide shr8(const Wide& a) {return each(a, a, [](auto x, auto) {return x >> 8;});}
+    // colors from a, alpha from b
+    static Wide color_alpha(const Wide& a, const Wide& b) {return {a[0], a[1], a[2], b[3]};}
+};
+
+#ifdef GEMPYRE_BLEND_SIMD
+#if defined(__AVX2__)
+struct Simd {
+    using Reg = __m256i;
+    static constexpr size_t Pixels = 8;
+    static Reg load(const dataT* p) {return _mm256_loadu_si256(reinterpret_cast<const Reg*>(p));}
+    static void store(dataT* p, Reg v) {_mm256_storeu_si256(reinterpret_cast<Reg*>(p), v);}
+    // unpack and pack are within 128-bit lanes, hence together they keep the pixel order
+    static Reg lo(Reg v) {return _mm256_unpacklo_epi8(v, _mm256_setzero_si256());}
+    static Reg hi(Reg v) {return _mm256_unpackhi_epi8(v, _mm256_setzero_si256());}
+    static Reg pack(Reg l, Reg h) {return _mm256_packus_epi16(l, h);}
+    static Reg set(uint32_t v) {return _mm256_set1_epi16(static_cast<short>(v));}
+    static Reg alpha(Reg w) {return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(w, 0xFF), 0xFF);}
+    static Reg mul(Reg a, Reg b) {return _mm256_mullo_epi16(a, b);}
+    static Reg add(Reg a, Reg b) {return _mm256_add_epi16(a, b);}
+    static Reg adds(Reg a, Reg b) {return _mm256_adds_epu16(a, b);}
+    static Reg sub(Reg a, Reg b) {return _mm256_sub_epi16(a, b);}
+    static Reg shr8(Reg a) {return _mm256_srli_epi16(a, 8);}
+    static Reg color_alpha(Reg a, Reg b) {
+        const auto mask = _mm256_set1_epi64x(static_cast<long long>(0xFFFF000000000000ULL));
+        return _mm256_or_si256(_mm256_andnot_si256(mask, a), _mm256_and_si256(mask, b));
+    }
+};
+#else
+struct Simd {
+    using Reg = __m128i;
+    static constexpr size_t Pixels = 4;
+    static Reg load(const dataT* p) {return _mm_loadu_si128(reinterpret_cast<const Reg*>(p));}
+    static void store(dataT* p, Reg v) {_mm_storeu_si128(reinterpret_cast<Reg*>(p), v);}
+    static Reg lo(Reg v) {return _mm_unpacklo_epi8(v, _mm_setzero_si128());}
+    static Reg hi(Reg v) {return _mm_unpackhi_epi8(v, _mm_setzero_si128());}
+    static Reg pack(Reg l, Reg h) {return _mm_packus_epi16(l, h);}
+    static Reg set(uint32_t v) {return _mm_set1_epi16(static_cast<short>(v));}
+    static Reg alpha(Reg w) {return _mm_shufflehi_epi16(_mm_shufflelo_epi16(w, 0xFF), 0xFF);}
+    static Reg mul(Reg a, Reg b) {return _mm_mullo_epi16(a, b);}
+    static Reg add(Reg a, Reg b) {return _mm_add_epi16(a, b);}
+    static Reg adds(Reg a, Reg b) {return _mm_adds_epu16(a, b);}
+    static Reg sub(Reg a, Reg b) {return _mm_sub_epi16(a, b);}
+    static Reg shr8(Reg a) {return _mm_srli_epi16(a, 8);}
+    static Reg color_alpha(Reg a, Reg b) {
+        const auto mask = _mm_set_epi32(static_cast<int>(0xFFFF0000), 0, static_cast<int>(0xFFFF0000), 0);
+        return _mm_or_si128(_mm_andnot_si128(mask, a), _mm_and_si128(mask, b));
+    }
+};
+#endif
+#endif
+
+// x / 255 rounded, exact for products of two components
+template<class V, class W>
+W div255(const W& x) {
+    const auto t = V::add(x, V::set(128));
+    return V::shr8(V::add(t, V::shr8(t)));
+}
+
+// x / 255 truncated, exact for products of two components
+template<class V, class W>
+W div255_floor(const W& x) {
+    return V::shr8(V::add(V::add(x, V::set(1)), V::shr8(x)));
+}
+
+// Porter-Duff: result = source * Fs + target * Ft
+enum class Factor {Zero, One, SourceAlpha, InverseSourceAlpha, TargetAlpha, InverseTargetAlpha};
+
+template<class V, Factor F, class W>
+W scaled(const W& c, const W& sa, const W& ta) {
+    if constexpr (F == Factor::Zero)
+        return V::set(0);
+    else if constexpr (F == Factor::One)
+        return c;
+    else if constexpr (F == Factor::SourceAlpha)
+        return div255<V>(V::mul(c, sa));
+    else if constexpr (F == Factor::InverseSourceAlpha)
+        return div255<V>(V::mul(c, V::sub(V::set(0xFF), sa)));
+    else if constexpr (F == Factor::TargetAlpha)
+        return div255<V>(V::mul(c, ta));
+    else
+        return div255<V>(V::mul(c, V::sub(V::set(0xFF), ta)));
+}
+
+template<Factor Fs, Factor Ft>
+struct PorterDuff {
+    template<class V, class W>
+    static W apply(const W& s, const W& t) {
+        const auto sa = V::alpha(s);
+        const auto ta = V::alpha(t);
+        return V::adds(scaled<V, Fs>(s, sa, ta), scaled<V, Ft>(t, sa, ta));
+    }
+};
+
+struct Add {
+    template<class V, class W>
+    static W apply(const W& s, const W& t) {
+        return V::adds(s, t);
+    }
+};
+
+// premultiplied multiply: s * t + s * (1 - ta) + t * (1 - sa), the same for alpha gives source over
+struct Multiply {
+    template<class V, class W>
+    static W apply(const W& s, const W& t) {
+        const auto sa = V::alpha(s);
+        const auto ta = V::alpha(t);
+        const auto st = div255<V>(V::mul(s, t));
+        return V::adds(V::adds(st, scaled<V, Factor::InverseTargetAlpha>(s, sa, ta)), scaled<V, Factor::InverseSourceAlpha>(t, sa, ta));
+    }
+};
+
+// colors are mixed by source alpha, not premultiplied, and alphas are added
+struct Merge {
+    template<class V, class W>
+    static W apply(const W& s, const W& t) {
+        const auto sa = V::alpha(s);
+        const auto mixed = div255_floor<V>(V::add(V::mul(t, V::sub(V::set(0xFF), sa)), V::mul(s, sa)));
+        return V::color_alpha(mixed, V::adds(t, s));
+    }
+};
+
+struct Premultiply {
+    template<class V, class W>
+    static W apply(const W& s, const W&) {
+        return V::color_alpha(div255<V>(V::mul(s, V::alpha(s))), s);
+    }
+};
+
+struct Lerp {
+    uint32_t weight;
+    template<class V, class W>
+    W apply(const W& a, const W& b) const {
+        const auto w = V::set(weight);
+        return V::shr8(V::add(V::add(V::mul(a, V::sub(V::set(0x100), w)), V::mul(b, w)), V::set(0x80)));
+    }
+};
+
+template<class Op>
+void run(const dataT* source, dataT* target, size_t count) {
+    size_t k = 0;
+#ifdef GEMPYRE_BLEND_SIMD
+    for(; k + Simd::Pixels <= count; k += Simd::Pixels) {
+        const auto s = Simd::load(source + k);
+        const auto t = Simd::load(target + k);
+        const auto l = Op::template apply<Simd>(Simd::lo(s), Simd::lo(t));
+        const auto h = Op::template apply<Simd>(Simd::hi(s), Simd::hi(t));
+        Simd::store(target + k, Simd::pack(l, h));
+    }
+#endif
+    for(; k < count; ++k)
+        target[k] = Scalar::narrow(Op::template apply<Scalar>(Scalar::widen(source[k]), Scalar::widen(target[k])));
+}
+
+// as run, but with two sources and a stateful operation
+template<class Op>
+void run(const Op& op, const dataT* a, const dataT* b, dataT* target, size_t count) {
+    size_t k = 0;
+#ifdef GEMPYRE_BLEND_SIMD
+    for(; k + Simd::Pixels <= count; k += Simd::Pixels) {
+        const auto s = Simd::load(a + k);
+        const auto t = Simd::load(b + k);
+        const auto l = op.template apply<Simd>(Simd::lo(s), Simd::lo(t));
+        const auto h = op.template apply<Simd>(Simd::hi(s), Simd::hi(t));
+        Simd::store(target + k, Simd::pack(l, h));
+    }
+#endif
+    for(; k < count; ++k)
+        target[k] = Scalar::narrow(op.template apply<Scalar>(Scalar::widen(a[k]), Scalar::widen(b[k])));
+}
+
+// 65536 * 255 / alpha, rounded
+constexpr std::array<uint32_t, 256> reciprocals() {
+    std::array<uint32_t, 256> table{};
+    for(uint32_t a = 1; a < 256; ++a)
+        table[a] = (0xFF * 0x10000 + a / 2) / a;
+    return table;
+}
+
+}
+
+void Gempyre::blend_row(BlendMode mode, const dataT* source, dataT* target, size_t count) {
+    using F = Factor;
+    switch(mode) {
+    case BlendMode::Clear: std::fill(target, target + count, 0); break;
+    case BlendMode::Source: std::memcpy(target, source, count * sizeof(dataT)); break;
+    case BlendMode::Destination: break;
+    case BlendMode::SourceOver: run<PorterDuff<F::One, F::InverseSourceAlpha>>(source, target, count); break;
+    case BlendMode::DestinationOver: run<PorterDuff<F::InverseTargetAlpha, F::One>>(source, target, count); break;
+    case BlendMode::SourceIn: run<PorterDuff<F::TargetAlpha, F::Zero>>(source, target, count); break;
+    case BlendMode::DestinationIn: run<PorterDuff<F::Zero, F::SourceAlpha>>(source, target, count); break;
+    case BlendMode::SourceOut: run<PorterDuff<F::InverseTargetAlpha, F::Zero>>(source, target, count); break;
+    case BlendMode::DestinationOut: run<PorterDuff<F::Zero, F::InverseSourceAlpha>>(source, target, count); break;
+    case BlendMode::SourceAtop: run<PorterDuff<F::TargetAlpha, F::InverseSourceAlpha>>(source, target, count); break;
+    case BlendMode::DestinationAtop: run<PorterDuff<F::InverseTargetAlpha, F::SourceAlpha>>(source, target, count); break;
+    case BlendMode::Xor: run<PorterDuff<F::InverseTargetAlpha, F::InverseSourceAlpha>>(source, target, count); break;
+    case BlendMode::Add: run<Add>(source, target, count); break;
+    case BlendMode::Multiply: run<Multiply>(source, target, count); break;
+    }
+}
+
+void Gempyre::merge_row(const dataT* source, dataT* target, size_t count) {
+    run<Merge>(source, target, count);
+}
+
+void Gempyre::premultiply_row(const dataT* source, dataT* target, size_t count) {
+    if(source != target)
+        std::memcpy(target, source, count * sizeof(dataT));
+    run<Premultiply>(target, target, count);
+}
+
+void Gempyre::unpremultiply_row(dataT* pixels, size_t count) {
+    static constexpr auto table = reciprocals();
+    for(size_t k = 0; k < count; ++k) {
+        const auto p = pixels[k];
+        const auto a = p >> 24;
+        if(a == 0xFF)
+            continue;
+        const auto r = table[a];
+        const auto c = [r](dataT v) {return std::min((v * r + 0x8000) >> 16, 0xFFU);};
+        pixels[k] = c(p & 0xFF) | (c((p >> 8) & 0xFF) << 8) | (c((p >> 16) & 0xFF) << 16) | (a << 24);
+    }
+}
+
+void Gempyre::lerp_row(const dataT* a, const dataT* b, dataT* target, size_t count, unsigned weight) {
+    if(weight == 0) {
+        if(a != target)
+            std::memcpy(target, a, count * sizeof(dataT));
+        return;
+    }
+    if(weight >= 0x100) {
+        if(b != target)
+            std::memcpy(target, b, count * sizeof(dataT));
+        return;
+    }
+    run(Lerp{weight}, a, b, target, count);
+}
@@ -0,0 +1,26 @@
+#ifndef BLEND_H
+#define BLEND_H
+
+#include "gempyre_types.h"
+#include "gempyre_bitmap.h"
+#include <cstddef>
+
+namespace Gempyre {
+
+// Row kernels for compositing RGBA pixels, vectorized with SSE2 or AVX2 when the build targets them.
+// Results are the same on every code path.
+
+// source is composited on target, both premultiplied
+void blend_row(BlendMode mode, const dataT* source, dataT* target, size_t count);
+// Bitmap::merge: colors are mixed by source alpha and alphas are added
+void merge_row(const dataT* source, dataT* target, size_t count);
+// color components multiplied by alpha, source and target may be the same
+void premultiply_row(const dataT* source, dataT* target, size_t count);
+// color components divided by alpha, in place
+void unpremultiply_row(dataT* pixels, size_t count);
+// target = a * (256 - weight) / 256 + b * weight / 256, weight is 0 - 256
+void lerp_row(const dataT* a, const dataT* b, dataT* target, size_t count, unsigned weight);
+
+}
+
+#endif // BLEND_H
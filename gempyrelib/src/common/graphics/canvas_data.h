@@ -6,11 +6,20 @@
 
 namespace Gempyre {
 class CanvasData  {
-private:
+public:
     enum DataTypes : dataT {
-      CanvasId = 0xAAA
+      CanvasId = 0xAAA,       // a single tile
+      CanvasFrameId = 0xAAB,  // tile records (x, y, width, height, codec, bytes, pixels) of a frame in one message
+      CanvasIndexedFrameId = 0xAAC, // palette (size, colors) and tile records of 8-bit indices
+      ImageBitmapId = 0xAAD,  // a tile record of an image, image name is the owner id
+      CanvasReadId = 0xAAE,   // from the UI: read id, tile index, x, y, width, height, RGBA bytes
+      VirtualTilesId = 0xAAF, // tile records of a virtual canvas, positions are in canvas coordinates
+      CanvasBlitId = 0xAB0    // copy of the header rect to the target x, y in data, ordered with the tiles
     };
-public:
+    // version is in the high half of the type word, from version 1 the canvas is referred by a handle
+    // that is the first header word, and the owner id is not sent
+    static constexpr dataT ProtocolVersion = 1;
+    static constexpr dataT versioned(dataT type) {return type | (ProtocolVersion << 16);}
     static constexpr auto NO_ID = "";
     CanvasData(int w, int h,  std::string_view owner);
     CanvasData(int w, int h) : CanvasData(w, h, NO_ID) {}
@@ -0,0 +1,565 @@
+#include "gempyre_bitmap.h"
+#include "gempyre_utils.h"
+#include "canvas_data.h"
+#ifndef __EMSCRIPTEN__
+#include "worker_pool.h"
+#endif
+#include <lodepng.h>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#ifndef WINDOWS_OS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#endif
+
+using namespace Gempyre;
+
+static constexpr size_t MaxPixels = 400'000'000; // as QOI reference, keeps the sizes within int
+
+// decoders ask the bitmap for pixels, once the size is known
+using Allocate = std::function<dataT* (int width, int height)>;
+
+static bool valid_size(uint64_t width, uint64_t height) {
+    return width > 0 && height > 0 && width * height <= MaxPixels;
+}
+
+namespace {
+
+// read-only view to a whole file
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filename) {
+#ifndef WINDOWS_OS
+        const auto fd = ::open(filename.c_str(), O_RDONLY);
+        if(fd < 0)
+            return;
+        struct stat info{};
+        if(::fstat(fd, &info) == 0 && info.st_size > 0) {
+            const auto size = static_cast<size_t>(info.st_size);
+            const auto address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(address != MAP_FAILED) {
+                m_data = static_cast<const uint8_t*>(address);
+                m_size = size;
+            }
+        }
+        ::close(fd);  // mapping stays valid
+#else
+        const auto file = ::CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(file == INVALID_HANDLE_VALUE)
+            return;
+        LARGE_INTEGER size{};
+        if(::GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+            m_mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if(m_mapping) {
+                m_data = static_cast<const uint8_t*>(::MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+                m_size = m_data ? static_cast<size_t>(size.QuadPart) : 0;
+            }
+        }
+        ::CloseHandle(file);
+#endif
+    }
+
+    ~MappedFile() {
+#ifndef WINDOWS_OS
+        if(m_data)
+            ::munmap(const_cast<uint8_t*>(m_data), m_size);
+#else
+        if(m_data)
+            ::UnmapViewOfFile(m_data);
+        if(m_mapping)
+            ::CloseHandle(m_mapping);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const {return m_data;}
+    size_t size() const {return m_size;}
+
+private:
+    const uint8_t* m_data{nullptr};
+    size_t m_size{0};
+#ifdef WINDOWS_OS
+    HANDLE m_mapping{nullptr};
+#endif
+};
+
+}
+
+// QOI, see https://qoiformat.org/qoi-specification.pdf
+
+static constexpr uint8_t QoiIndex = 0x00;
+static constexpr uint8_t QoiDiff = 0x40;
+static constexpr uint8_t QoiLuma = 0x80;
+static constexpr uint8_t QoiRun = 0xC0;
+static constexpr uint8_t QoiRgb = 0xFE;
+static constexpr uint8_t QoiRgba = 0xFF;
+static constexpr uint8_t QoiMask = 0xC0;
+static constexpr size_t QoiHeader = 14;
+static constexpr std::array<uint8_t, 8> QoiEnd{0, 0, 0, 0, 0, 0, 0, 1};
+
+static unsigned qoi_hash(dataT p) {
+    return (Color::r(p) * 3 + Color::g(p) * 5 + Color::b(p) * 7 + Color::alpha(p) * 11) % 64;
+}
+
+static uint32_t read_be32(const uint8_t* bytes) {
+    return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
+        (static_cast<uint32_t>(bytes[2]) << 8) | bytes[3];
+}
+
+static void write_be32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static bool is_qoi(const uint8_t* bytes, size_t size) {
+    return size >= QoiHeader && std::memcmp(bytes, "qoif", 4) == 0;
+}
+
+static const char* qoi_decode(const uint8_t* bytes, size_t size, const Allocate& allocate) {
+    const auto width = read_be32(bytes + 4);
+    const auto height = read_be32(bytes + 8);
+    if(!valid_size(width, height))
+        return "Invalid QOI size";
+    // an op encodes at most a run of 62 pixels, hence the data is checked before the pixels are allocated
+    const auto count = static_cast<size_t>(width) * height;
+    const auto ops = size > QoiHeader + QoiEnd.size() ? size - QoiHeader - QoiEnd.size() : 0;
+    if(count > ops * 62)
+        return "Truncated QOI";
+    const auto pixels = allocate(static_cast<int>(width), static_cast<int>(height));
+    std::array<dataT, 64> index{};
+    auto pixel = Color::rgba(0, 0, 0, 0xFF);
+    auto pos = QoiHeader;
+    const auto end = size > QoiEnd.size() ? size - QoiEnd.size() : 0;
+    unsigned run = 0;
+    for(size_t k = 0; k < count; ++k) {
+        if(run > 0) {
+            --run;
+        } else if(pos < end) {
+            const auto op = bytes[pos++];
+            // 8-bit tags are tested first, as they overlap the run tag
+            if(op == QoiRgb) {
+                if(pos + 3 > end)
+                    return "Truncated QOI";
+                pixel = Color::rgba(bytes[pos], bytes[pos + 1], bytes[pos + 2], Color::alpha(pixel));
+                pos += 3;
+            } else if(op == QoiRgba) {
+                if(pos + 4 > end)
+                    return "Truncated QOI";
+                pixel = Color::rgba(bytes[pos], bytes[pos + 1], bytes[pos + 2], bytes[pos + 3]);
+                pos += 4;
+            } else if((op & QoiMask) == QoiIndex) {
+                pixel = index[op];
+            } else if((op & QoiMask) == QoiDiff) {
+                pixel = Color::rgba((Color::r(pixel) + ((op >> 4) & 3) - 2) & 0xFF,
+                    (Color::g(pixel) + ((op >> 2) & 3) - 2) & 0xFF,
+                    (Color::b(pixel) + (op & 3) - 2) & 0xFF, Color::alpha(pixel));
+            } else if((op & QoiMask) == QoiLuma && pos < end) {
+                const auto next = bytes[pos++];
+                const auto green = static_cast<dataT>(op & 0x3F) - 32;
+                pixel = Color::rgba((Color::r(pixel) + green - 8 + ((next >> 4) & 0x0F)) & 0xFF,
+                    (Color::g(pixel) + green) & 0xFF,
+                    (Color::b(pixel) + green - 8 + (next & 0x0F)) & 0xFF, Color::alpha(pixel));
+            } else if((op & QoiMask) == QoiRun) {
+                run = op & 0x3F;
+            } else {
+                return "Truncated QOI";
+            }
+            index[qoi_hash(pixel)] = pixel;
+        } else {
+            return "Truncated QOI";
+        }
+        pixels[k] = pixel;
+    }
+    return nullptr;
+}
+
+static std::vector<uint8_t> qoi_encode(const dataT* pixels, int width, int height) {
+    const auto count = static_cast<size_t>(width) * static_cast<size_t>(height);
+    std::vector<uint8_t> out;
+    out.reserve(QoiHeader + count * 2 + QoiEnd.size());  // grows if the image does not compress
+    out.insert(out.end(), {'q', 'o', 'i', 'f'});
+    write_be32(out, static_cast<uint32_t>(width));
+    write_be32(out, static_cast<uint32_t>(height));
+    out.push_back(4);   // RGBA
+    out.push_back(0);   // sRGB
+    std::array<dataT, 64> index{};
+    auto previous = Color::rgba(0, 0, 0, 0xFF);
+    unsigned run = 0;
+    for(size_t k = 0; k < count; ++k) {
+        const auto pixel = pixels[k];
+        if(pixel == previous) {
+            if(++run == 62 || k + 1 == count) {
+                out.push_back(static_cast<uint8_t>(QoiRun | (run - 1)));
+                run = 0;
+            }
+            continue;
+        }
+        if(run > 0) {
+            out.push_back(static_cast<uint8_t>(QoiRun | (run - 1)));
+            run = 0;
+        }
+        const auto hash = qoi_hash(pixel);
+        if(index[hash] == pixel) {
+            out.push_back(static_cast<uint8_t>(QoiIndex | hash));
+        } else {
+            index[hash] = pixel;
+            if(Color::alpha(pixel) == Color::alpha(previous)) {
+                const auto dr = static_cast<int8_t>(Color::r(pixel) - Color::r(previous));
+                const auto dg = static_cast<int8_t>(Color::g(pixel) - Color::g(previous));
+                const auto db = static_cast<int8_t>(Color::b(pixel) - Color::b(previous));
+                const auto dr_dg = dr - dg;
+                const auto db_dg = db - dg;
+                if(dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2) {
+                    out.push_back(static_cast<uint8_t>(QoiDiff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+                } else if(dr_dg > -9 && dr_dg < 8 && dg > -33 && dg < 32 && db_dg > -9 && db_dg < 8) {
+                    out.push_back(static_cast<uint8_t>(QoiLuma | (dg + 32)));
+                    out.push_back(static_cast<uint8_t>((dr_dg + 8) << 4 | (db_dg + 8)));
+                } else {
+                    out.insert(out.end(), {QoiRgb, static_cast<uint8_t>(Color::r(pixel)),
+                        static_cast<uint8_t>(Color::g(pixel)), static_cast<uint8_t>(Color::b(pixel))});
+                }
+            } else {
+                out.insert(out.end(), {QoiRgba, static_cast<uint8_t>(Color::r(pixel)), static_cast<uint8_t>(Color::g(pixel)),
+                    static_cast<uint8_t>(Color::b(pixel)), static_cast<uint8_t>(Color::alpha(pixel))});
+            }
+        }
+        previous = pixel;
+    }
+    out.insert(out.end(), QoiEnd.begin(), QoiEnd.end());
+    return out;
+}
+
+// Netpbm: P5 (gray), P6 (RGB) and P7 (PAM, 1 - 4 channels), see https://netpbm.sourceforge.net/doc/
+
+static bool is_netpbm(const uint8_t* bytes, size_t size) {
+    return size > 2 && bytes[0] == 'P' && (bytes[1] == '5' || bytes[1] == '6' || bytes[1] == '7');
+}
+
+namespace {
+
+class NetpbmHeader {
+public:
+    NetpbmHeader(const uint8_t* bytes, size_t size) : m_bytes{bytes}, m_size{size}, m_pos{2} {}
+
+    // whitespace separated token, comments are skipped
+    std::string_view token() {
+        while(m_pos < m_size) {
+            if(m_bytes[m_pos] == '#') {
+                while(m_pos < m_size && m_bytes[m_pos] != '\n')
+                    ++m_pos;
+            } else if(std::isspace(m_bytes[m_pos])) {
+                ++m_pos;
+            } else {
+                break;
+            }
+        }
+        const auto begin = m_pos;
+        while(m_pos < m_size && !std::isspace(m_bytes[m_pos]))
+            ++m_pos;
+        return {reinterpret_cast<const char*>(m_bytes) + begin, m_pos - begin};
+    }
+
+    uint32_t number() {
+        return GempyreUtils::parse<uint32_t>(token()).value_or(0);
+    }
+
+    // raster starts after a single whitespace
+    size_t raster() const {return m_pos + 1;}
+
+private:
+    const uint8_t* m_bytes;
+    size_t m_size;
+    size_t m_pos;
+};
+
+}
+
+static const char* netpbm_decode(const uint8_t* bytes, size_t size, const Allocate& allocate) {
+    NetpbmHeader header(bytes, size);
+    uint32_t width = 0, height = 0, depth = 0, maxval = 0;
+    if(bytes[1] == '7') {
+        for(auto key = header.token(); key != "ENDHDR"; key = header.token()) {
+            if(key.empty())
+                return "Invalid PAM header";
+            if(key == "WIDTH")
+                width = header.number();
+            else if(key == "HEIGHT")
+                height = header.number();
+            else if(key == "DEPTH")
+                depth = header.number();
+            else if(key == "MAXVAL")
+                maxval = header.number();
+            else if(key == "TUPLTYPE")
+                header.token(); // channels are told by depth
+        }
+    } else {
+        depth = bytes[1] == '5' ? 1 : 3;
+        width = header.number();
+        height = header.number();
+        maxval = header.number();
+    }
+    if(!valid_size(width, height) || depth < 1 || depth > 4 || maxval < 1 || maxval > 0xFFFF)
+        return "Invalid PPM header";
+    const auto sample_bytes = maxval > 0xFF ? 2U : 1U;
+    const auto count = static_cast<size_t>(width) * height;
+    const auto raster = header.raster();
+    if(raster > size || (size - raster) / (depth * sample_bytes) < count)
+        return "Truncated PPM";
+    const auto pixels = allocate(static_cast<int>(width), static_cast<int>(height));
+    auto in = bytes + raster;
+    const auto sample = [&in, sample_bytes, maxval]() -> dataT {
+        // values above maxval are invalid, clamped so that they do not spill into other channels
+        const auto value = std::min<dataT>(sample_bytes == 1 ? in[0] : (static_cast<dataT>(in[0]) << 8) | in[1], maxval);
+        in += sample_bytes;
+        return maxval == 0xFF ? value : (value * 0xFF + maxval / 2) / maxval;
+    };
+    for(size_t k = 0; k < count; ++k) {
+        switch(depth) {
+        case 1: {
+            const auto gray = sample();
+            pixels[k] = Color::rgba(gray, gray, gray);
+            break;
+        }
+        case 2: {
+            const auto gray = sample();
+            pixels[k] = Color::rgba(gray, gray, gray, sample());
+            break;
+        }
+        case 3: {
+            const auto r = sample();
+            const auto g = sample();
+            pixels[k] = Color::rgba(r, g, sample());
+            break;
+        }
+        default: {
+            const auto r = sample();
+            const auto g = sample();
+            const auto b = sample();
+            pixels[k] = Color::rgba(r, g, b, sample());
+            break;
+        }
+        }
+    }
+    return nullptr;
+}
+
+static std::vector<uint8_t> netpbm_encode(const dataT* pixels, int width, int height, bool alpha) {
+    const auto header = alpha ?
+        "P7\nWIDTH " + std::to_string(width) + "\nHEIGHT " + std::to_string(height) + "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n" :
+        "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+    const auto count = static_cast<size_t>(width) * static_cast<size_t>(height);
+    std::vector<uint8_t> out(header.size() + count * (alpha ? 4 : 3));
+    std::memcpy(out.data(), header.data(), header.size());
+    auto pos = out.data() + header.size();
+    if(alpha) {
+        std::memcpy(pos, pixels, count * sizeof(dataT)); // pixels are RGBA bytes
+        return out;
+    }
+    for(size_t k = 0; k < count; ++k) {
+        const auto p = pixels[k];
+        *pos++ = static_cast<uint8_t>(Color::r(p));
+        *pos++ = static_cast<uint8_t>(Color::g(p));
+        *pos++ = static_cast<uint8_t>(Color::b(p));
+    }
+    return out;
+}
+
+// PNG
+
+static bool is_png(const uint8_t* bytes, size_t size) {
+    static constexpr std::array<uint8_t, 8> signature{0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    return size >= signature.size() && std::equal(signature.begin(), signature.end(), bytes);
+}
+
+static void set_compression(LodePNGCompressSettings& settings, int level) {
+    level = std::clamp(level, 0, 9);
+    if(level == 0) {
+        settings.btype = 0; // stored
+        settings.use_lz77 = 0;
+        return;
+    }
+    settings.btype = 2;
+    settings.use_lz77 = 1;
+    settings.windowsize = 1U << std::min(15, 7 + level);    // 4 is the lodepng default 2048
+    settings.minmatch = 3;
+    settings.nicematch = level < 4 ? 32 : (level < 7 ? 128 : 258);
+    settings.lazymatching = level < 4 ? 0 : 1;
+}
+
+static unsigned paeth(int a, int b, int c) {
+    const auto pa = std::abs(b - c);
+    const auto pb = std::abs(a - c);
+    const auto pc = std::abs(a + b - 2 * c);
+    return static_cast<unsigned>(pc < pa && pc < pb ? c : (pb < pa ? b : a));
+}
+
+// filter of each row as LFS_MINSUM of lodepng, but rows are independent and done in parallel
+static std::vector<unsigned char> minsum_filters(const uint8_t* bytes, int width, int height) {
+    const auto line = static_cast<size_t>(width) * sizeof(dataT);
+    std::vector<unsigned char> filters(static_cast<size_t>(height));
+    const auto choose = [&](size_t begin, size_t end) {
+        for(auto y = begin; y < end; ++y) {
+            const auto row = bytes + y * line;
+            const auto up = y > 0 ? row - line : nullptr;
+            std::array<size_t, 5> sums{};
+            for(size_t i = 0; i < line; ++i) {
+                const int a = i >= sizeof(dataT) ? row[i - sizeof(dataT)] : 0;
+                const int b = up ? up[i] : 0;
+                const int c = up && i >= sizeof(dataT) ? up[i - sizeof(dataT)] : 0;
+                const auto x = row[i];
+                const auto add = [&sums](size_t type, unsigned value) {
+                    const auto s = static_cast<uint8_t>(value);
+                    sums[type] += s < 128 ? s : 255U - s; // as signed difference
+                };
+                sums[0] += x;
+                add(1, x - static_cast<unsigned>(a));
+                add(2, x - static_cast<unsigned>(b));
+                add(3, x - static_cast<unsigned>((a + b) / 2));
+                add(4, x - paeth(a, b, c));
+            }
+            filters[y] = static_cast<unsigned char>(std::min_element(sums.begin(), sums.end()) - sums.begin());
+        }
+    };
+#ifndef __EMSCRIPTEN__
+    WorkerPool::shared().run(filters.size(), [&choose](size_t begin, size_t end, unsigned) {
+        choose(begin, end);
+    });
+#else
+    choose(0, filters.size());
+#endif
+    return filters;
+}
+
+std::vector<uint8_t> Bitmap::png_image(const PngOptions& options) const {
+    std::vector<uint8_t> out;
+    if(empty())
+        return out;
+    lodepng::State state;
+    auto& encoder = state.encoder;
+    encoder.auto_convert = options.optimize_color ? 1 : 0;
+    state.info_png.color.colortype = LCT_RGBA;  // used if not auto_convert
+    state.info_png.color.bitdepth = 8;
+    set_compression(encoder.zlibsettings, options.compression);
+    const auto bytes = reinterpret_cast<const unsigned char*>(m_canvas->data());
+    std::vector<unsigned char> filters;
+    switch(options.filter) {
+    case PngOptions::RowFilter::None: encoder.filter_strategy = LFS_ZERO; break;
+    case PngOptions::RowFilter::Sub: encoder.filter_strategy = LFS_ONE; break;
+    case PngOptions::RowFilter::Up: encoder.filter_strategy = LFS_TWO; break;
+    case PngOptions::RowFilter::Average: encoder.filter_strategy = LFS_THREE; break;
+    case PngOptions::RowFilter::Paeth: encoder.filter_strategy = LFS_FOUR; break;
+    case PngOptions::RowFilter::Entropy: encoder.filter_strategy = LFS_ENTROPY; break;
+    case PngOptions::RowFilter::MinSum:
+        if(options.threaded) {
+            filters = minsum_filters(bytes, width(), height());
+            encoder.filter_strategy = LFS_PREDEFINED;
+            encoder.predefined_filters = filters.data();
+        } else {
+            encoder.filter_strategy = LFS_MINSUM;
+        }
+        break;
+    }
+    const auto error = lodepng::encode(out, bytes, static_cast<unsigned>(width()), static_cast<unsigned>(height()), state);
+    if(error) {
+        GempyreUtils::log(GempyreUtils::LogLevel::Error, "PNG encode failed", lodepng_error_text(error));
+        out.clear();
+    }
+    return out;
+}
+
+std::vector<uint8_t> Bitmap::png_image() const {
+    return png_image(PngOptions{});
+}
+
+std::vector<uint8_t> Bitmap::qoi_image() const {
+    return empty() ? std::vector<uint8_t>{} : qoi_encode(m_canvas->data(), width(), height());
+}
+
+std::vector<uint8_t> Bitmap::ppm_image() const {
+    return empty() ? std::vector<uint8_t>{} : netpbm_encode(m_canvas->data(), width(), height(), false);
+}
+
+std::vector<uint8_t> Bitmap::pam_image() const {
+    return empty() ? std::vector<uint8_t>{} : netpbm_encode(m_canvas->data(), width(), height(), true);
+}
+
+Bitmap::Bitmap(const std::vector<unsigned char>& image_data) : Bitmap(image_data.data(), image_data.size()) {
+}
+
+Bitmap::Bitmap(const uint8_t* bytes, size_t size) {
+    const auto allocate = [this](int width, int height) {
+        create(width, height);
+        return inner_data();
+    };
+    if(bytes && is_qoi(bytes, size)) {
+        if(const auto error = qoi_decode(bytes, size, allocate))
+            throw std::runtime_error(error);
+        return;
+    }
+    if(bytes && is_netpbm(bytes, size)) {
+        if(const auto error = netpbm_decode(bytes, size, allocate))
+            throw std::runtime_error(error);
+        return;
+    }
+    if(!bytes || !is_png(bytes, size))
+        throw std::runtime_error("Unknown image format");
+    // lodepng allocates the pixels itself, they are copied once
+    unsigned char* image = nullptr;
+    unsigned width = 0, height = 0;
+    const auto error = lodepng_decode_memory(&image, &width, &height, bytes, size, LCT_RGBA, 8);
+    std::unique_ptr<unsigned char, decltype(&std::free)> image_ptr(image, &std::free);
+    if(error)
+        throw std::runtime_error(lodepng_error_text(error));
+    if(!valid_size(width, height))
+        throw std::runtime_error("Invalid PNG size");
+    std::memcpy(allocate(static_cast<int>(width), static_cast<int>(height)), image, static_cast<size_t>(width) * height * sizeof(dataT));
+}
+
+std::optional<Bitmap> Bitmap::load(std::string_view filename) {
+    const MappedFile file{std::string{filename}};
+    if(!file.data()) {
+        GempyreUtils::log(GempyreUtils::LogLevel::Error, "Cannot read image", GempyreUtils::qq(filename));
+        return std::nullopt;
+    }
+    try {
+        return Bitmap(file.data(), file.size());
+    } catch(const std::runtime_error& e) {
+        GempyreUtils::log(GempyreUtils::LogLevel::Error, "Cannot decode image", GempyreUtils::qq(filename), e.what());
+        return std::nullopt;
+    }
+}
+
+bool Bitmap::save(std::string_view filename, const PngOptions& options) const {
+    if(empty())
+        return false;
+    const auto extension = GempyreUtils::to_low(std::get<1>(GempyreUtils::split_name(filename)));
+    const auto bytes = extension == "qoi" ? qoi_image() :
+        extension == "ppm" ? ppm_image() :
+        extension == "pam" ? pam_image() :
+        png_image(options);
+    if(bytes.empty())
+        return false;
+    std::ofstream out(std::string{filename}, std::ios::out | std::ios::binary);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return out.good();
+}
@@ -0,0 +1,173 @@
+#include "pixel_format.h"
+#include "gempyre_bitmap.h"
+#include "canvas_data.h"
+#include <cstring>
+
+// conversions are bound by memory, hence 128-bit registers are enough, also on AVX2 builds
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GEMPYRE_CONVERT_SIMD
+#endif
+
+using namespace Gempyre;
+
+#ifdef GEMPYRE_CONVERT_SIMD
+using Reg = __m128i;
+static Reg load(const void* p) {return _mm_loadu_si128(static_cast<const Reg*>(p));}
+static void store(void* p, Reg v) {_mm_storeu_si128(static_cast<Reg*>(p), v);}
+#endif
+
+static constexpr unsigned LumaR = 77;
+static constexpr unsigned LumaG = 150;
+static constexpr unsigned LumaB = 29;
+
+void Gempyre::gray_to_rgba_row(const uint8_t* source, dataT* target, size_t count) {
+    size_t k = 0;
+#ifdef GEMPYRE_CONVERT_SIMD
+    const auto opaque = _mm_set1_epi8(static_cast<char>(0xFF));
+    for(; k + 16 <= count; k += 16) {
+        const auto g = load(source + k);
+        // words of (gray, gray) and (gray, alpha) are interleaved into pixels
+        const auto gg_lo = _mm_unpacklo_epi8(g, g);
+        const auto gg_hi = _mm_unpackhi_epi8(g, g);
+        const auto ga_lo = _mm_unpacklo_epi8(g, opaque);
+        const auto ga_hi = _mm_unpackhi_epi8(g, opaque);
+        store(target + k, _mm_unpacklo_epi16(gg_lo, ga_lo));
+        store(target + k + 4, _mm_unpackhi_epi16(gg_lo, ga_lo));
+        store(target + k + 8, _mm_unpacklo_epi16(gg_hi, ga_hi));
+        store(target + k + 12, _mm_unpackhi_epi16(gg_hi, ga_hi));
+    }
+#endif
+    for(; k < count; ++k)
+        target[k] = source[k] * 0x010101U | 0xFF000000U;
+}
+
+#ifdef GEMPYRE_CONVERT_SIMD
+// luma of 4 pixels in 32-bit lanes, the weighted sum fits in 16 bits
+static Reg luma(Reg p) {
+    const auto mask = _mm_set1_epi32(0xFF);
+    const auto r = _mm_mullo_epi16(_mm_and_si128(p, mask), _mm_set1_epi32(LumaR));
+    const auto g = _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi32(p, 8), mask), _mm_set1_epi32(LumaG));
+    const auto b = _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi32(p, 16), mask), _mm_set1_epi32(LumaB));
+    const auto sum = _mm_add_epi16(_mm_add_epi16(r, g), _mm_add_epi16(b, _mm_set1_epi32(0x80)));
+    return _mm_srli_epi32(sum, 8);
+}
+#endif
+
+void Gempyre::rgba_to_gray_row(const dataT* source, uint8_t* target, size_t count) {
+    size_t k = 0;
+#ifdef GEMPYRE_CONVERT_SIMD
+    for(; k + 16 <= count; k += 16) {
+        const auto l0 = _mm_packs_epi32(luma(load(source + k)), luma(load(source + k + 4)));
+        const auto l1 = _mm_packs_epi32(luma(load(source + k + 8)), luma(load(source + k + 12)));
+        store(target + k, _mm_packus_epi16(l0, l1));
+    }
+#endif
+    for(; k < count; ++k) {
+        const auto p = source[k];
+        target[k] = static_cast<uint8_t>(((p & 0xFF) * LumaR + ((p >> 8) & 0xFF) * LumaG + ((p >> 16) & 0xFF) * LumaB + 0x80) >> 8);
+    }
+}
+
+void Gempyre::rgb565_to_rgba_row(const uint16_t* source, dataT* target, size_t count) {
+    size_t k = 0;
+#ifdef GEMPYRE_CONVERT_SIMD
+    const auto mask = [](int m) {return _mm_set1_epi16(static_cast<short>(m));};
+    for(; k + 8 <= count; k += 8) {
+        const auto v = load(source + k);
+        // high bits of a component are repeated in its low bits
+        const auto r = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, 8), mask(0xF8)), _mm_srli_epi16(v, 13));
+        const auto g = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, 3), mask(0xFC)), _mm_and_si128(_mm_srli_epi16(v, 9), mask(0x03)));
+        const auto b = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(v, 3), mask(0xF8)), _mm_and_si128(_mm_srli_epi16(v, 2), mask(0x07)));
+        const auto rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+        const auto ba = _mm_or_si128(b, mask(0xFF00));
+        store(target + k, _mm_unpacklo_epi16(rg, ba));
+        store(target + k + 4, _mm_unpackhi_epi16(rg, ba));
+    }
+#endif
+    for(; k < count; ++k) {
+        const dataT v = source[k];
+        const auto r = ((v >> 8) & 0xF8) | (v >> 13);
+        const auto g = ((v >> 3) & 0xFC) | ((v >> 9) & 0x03);
+        const auto b = ((v << 3) & 0xF8) | ((v >> 2) & 0x07);
+        target[k] = r | (g << 8) | (b << 16) | 0xFF000000U;
+    }
+}
+
+#ifdef GEMPYRE_CONVERT_SIMD
+// 565 of 4 pixels in 32-bit lanes, sign extended for a signed pack
+static Reg rgb565(Reg p) {
+    const auto r = _mm_slli_epi32(_mm_and_si128(p, _mm_set1_epi32(0xF8)), 8);
+    const auto g = _mm_and_si128(_mm_srli_epi32(p, 5), _mm_set1_epi32(0x07E0));
+    const auto b = _mm_and_si128(_mm_srli_epi32(p, 19), _mm_set1_epi32(0x1F));
+    const auto v = _mm_or_si128(_mm_or_si128(r, g), b);
+    return _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+}
+#endif
+
+void Gempyre::rgba_to_rgb565_row(const dataT* source, uint16_t* target, size_t count) {
+    size_t k = 0;
+#ifdef GEMPYRE_CONVERT_SIMD
+    for(; k + 8 <= count; k += 8)
+        store(target + k, _mm_packs_epi32(rgb565(load(source + k)), rgb565(load(source + k + 4))));
+#endif
+    for(; k < count; ++k) {
+        const auto p = source[k];
+        target[k] = static_cast<uint16_t>(((p & 0xF8) << 8) | ((p >> 5) & 0x07E0) | ((p >> 19) & 0x1F));
+    }
+}
+
+void Gempyre::swap_rb_row(const dataT* source, dataT* target, size_t count) {
+    size_t k = 0;
+#ifdef GEMPYRE_CONVERT_SIMD
+    const auto ga_mask = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+    for(; k + 4 <= count; k += 4) {
+        const auto p = load(source + k);
+        const auto rb = _mm_andnot_si128(ga_mask, p);
+        const auto br = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+        store(target + k, _mm_or_si128(_mm_and_si128(p, ga_mask), br));
+    }
+#endif
+    for(; k < count; ++k) {
+        const auto p = source[k];
+        target[k] = (p & 0xFF00FF00) | ((p & 0xFF) << 16) | ((p >> 16) & 0xFF);
+    }
+}
+
+// row conversions of each format
+static void to_rgba(const uint8_t* source, dataT* target, size_t count) {gray_to_rgba_row(source, target, count);}
+static void to_rgba(const uint16_t* source, dataT* target, size_t count) {rgb565_to_rgba_row(source, target, count);}
+static void to_rgba(const uint32_t* source, dataT* target, size_t count) {swap_rb_row(source, target, count);}
+static void from_rgba(const dataT* source, uint8_t* target, size_t count) {rgba_to_gray_row(source, target, count);}
+static void from_rgba(const dataT* source, uint16_t* target, size_t count) {rgba_to_rgb565_row(source, target, count);}
+static void from_rgba(const dataT* source, uint32_t* target, size_t count) {swap_rb_row(source, target, count);}
+
+template<class Format>
+void PixelBitmap<Format>::assign(const BitmapView& view) {
+    if(view.empty()) {
+        create(0, 0);
+        return;
+    }
+    if(view.width() != m_width || view.height() != m_height)
+        create(view.width(), view.height());
+    const auto width = static_cast<size_t>(m_width);
+    for(auto y = 0; y < m_height; ++y)
+        from_rgba(view.row(y), m_data.data() + static_cast<size_t>(y) * width, width);
+}
+
+template<class Format>
+Bitmap PixelBitmap<Format>::to_bitmap(const value_type* pixels, int width, int height, int stride) {
+    Bitmap bmp;
+    if(!pixels || width <= 0 || height <= 0)
+        return bmp;
+    bmp.create(width, height);
+    const auto target = bmp.inner_data();
+    const auto step = static_cast<ptrdiff_t>(stride > 0 ? stride : width);
+    for(auto y = 0; y < height; ++y)
+        to_rgba(pixels + y * step, target + static_cast<ptrdiff_t>(y) * width, static_cast<size_t>(width));
+    return bmp;
+}
+
+template class Gempyre::PixelBitmap<PixelFormat::Gray8>;
+template class Gempyre::PixelBitmap<PixelFormat::RGB565>;
+template class Gempyre::PixelBitmap<PixelFormat::BGRA>;
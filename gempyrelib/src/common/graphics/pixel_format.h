@@ -0,0 +1,26 @@
+#ifndef PIXEL_FORMAT_H
+#define PIXEL_FORMAT_H
+
+#include "gempyre_types.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace Gempyre {
+
+// Row kernels converting between RGBA pixels and compact formats, vectorized with SSE2 when the build targets it.
+// Results are the same on every code path.
+
+// gray to opaque RGBA
+void gray_to_rgba_row(const uint8_t* source, dataT* target, size_t count);
+// RGBA to luma (77 R + 150 G + 29 B) / 256 rounded, alpha is dropped
+void rgba_to_gray_row(const dataT* source, uint8_t* target, size_t count);
+// R5 G6 B5 to opaque RGBA, components are scaled to the full range
+void rgb565_to_rgba_row(const uint16_t* source, dataT* target, size_t count);
+// RGBA to R5 G6 B5 truncated, alpha is dropped
+void rgba_to_rgb565_row(const dataT* source, uint16_t* target, size_t count);
+// swap red and blue: BGRA to RGBA and vice versa, source and target may be the same
+void swap_rb_row(const dataT* source, dataT* target, size_t count);
+
+}
+
+#endif // PIXEL_FORMAT_H
@@ -0,0 +1,260 @@
+#include "gempyre_bitmap.h"
+#include "canvas_data.h"
+#include "blend.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+using namespace Gempyre;
+
+// Scanline rasterizer: each pixel row is sampled at SubScanlines heights, where horizontal coverage is exact.
+// Coverage of a pixel is 0 - FullCoverage.
+static constexpr int SubScanlines = 4;
+static constexpr int SubCoverage = 64;
+static constexpr int FullCoverage = SubScanlines * SubCoverage;
+
+using Contour = std::vector<Point>;
+
+namespace {
+
+struct Edge {
+    double x0, y0, x1, y1;  // y0 < y1
+    double dxdy;
+    int winding;
+};
+
+struct Crossing {
+    double x;
+    int winding;
+    bool operator<(const Crossing& other) const {return x < other.x;}
+};
+
+class Rasterizer {
+public:
+    Rasterizer(dataT* pixels, int width, int height) : m_pixels{pixels}, m_width{width}, m_height{height},
+        m_coverage(static_cast<size_t>(width) + 1), m_spans(static_cast<size_t>(width) + 1), m_row(static_cast<size_t>(width)) {}
+
+    void fill(const std::vector<Contour>& contours, dataT color, FillRule rule) {
+        if((color >> 24) == 0 || !edges(contours))
+            return;
+        colors(color);
+        // far off-bitmap points are finite but may not fit in int, hence rows are clamped before the cast
+        const auto height = static_cast<double>(m_height);
+        const auto top = static_cast<int>(std::floor(std::clamp(m_edges.front().y0, 0.0, height)));
+        auto bottom = 0.0;
+        for(const auto& e : m_edges)
+            bottom = std::max(bottom, e.y1);
+        const auto last = static_cast<int>(std::ceil(std::clamp(bottom, 0.0, height)));
+        size_t next = 0;
+        std::vector<const Edge*> active;
+        for(auto y = top; y < last; ++y) {
+            m_left = m_width;
+            m_right = 0;
+            for(auto k = 0; k < SubScanlines; ++k) {
+                const auto sy = y + (k + 0.5) / SubScanlines;
+                while(next < m_edges.size() && m_edges[next].y0 <= sy)
+                    active.push_back(&m_edges[next++]);
+                active.erase(std::remove_if(active.begin(), active.end(), [sy](const Edge* e) {return e->y1 <= sy;}), active.end());
+                m_crossings.clear();
+                for(const auto e : active)
+                    m_crossings.push_back({e->x0 + (sy - e->y0) * e->dxdy, e->winding});
+                std::sort(m_crossings.begin(), m_crossings.end());
+                scanline(rule);
+            }
+            if(m_left < m_right)
+                paint(y);
+        }
+    }
+
+private:
+    bool edges(const std::vector<Contour>& contours) {
+        m_edges.clear();
+        for(const auto& contour : contours) {
+            const auto count = contour.size();
+            for(size_t i = 0; count > 2 && i < count; ++i) {
+                const auto& a = contour[i];
+                const auto& b = contour[(i + 1) % count];
+                if(!std::isfinite(a.x) || !std::isfinite(a.y) || !std::isfinite(b.x) || !std::isfinite(b.y))
+                    return false;
+                if(a.y == b.y)
+                    continue; // horizontal edges do not cross scanlines
+                if(a.y < b.y)
+                    m_edges.push_back({a.x, a.y, b.x, b.y, (b.x - a.x) / (b.y - a.y), 1});
+                else
+                    m_edges.push_back({b.x, b.y, a.x, a.y, (a.x - b.x) / (a.y - b.y), -1});
+            }
+        }
+        std::sort(m_edges.begin(), m_edges.end(), [](const Edge& a, const Edge& b) {return a.y0 < b.y0;});
+        return !m_edges.empty();
+    }
+
+    // premultiplied color for each coverage
+    void colors(dataT color) {
+        const auto alpha = color >> 24;
+        m_opaque = alpha == 0xFF;
+        for(auto c = 0; c <= FullCoverage; ++c) {
+            const auto a = (alpha * static_cast<unsigned>(c) + FullCoverage / 2) / FullCoverage;
+            const auto mul = [a](dataT v) {return (v * a + 127) / 255;};
+            m_colors[static_cast<size_t>(c)] = mul(color & 0xFF) | (mul((color >> 8) & 0xFF) << 8) | (mul((color >> 16) & 0xFF) << 16) | (a << 24);
+        }
+        m_color = color;
+    }
+
+    void scanline(FillRule rule) {
+        const auto inside = [rule](int winding) {return rule == FillRule::EvenOdd ? (winding & 1) != 0 : winding != 0;};
+        auto winding = 0;
+        auto start = 0.0;
+        for(const auto& crossing : m_crossings) {
+            const auto was = inside(winding);
+            winding += crossing.winding;
+            const auto is = inside(winding);
+            if(!was && is)
+                start = crossing.x;
+            else if(was && !is)
+                span(start, crossing.x);
+        }
+    }
+
+    // ends of a span are partially covered, the pixels between via a difference array
+    void span(double from, double to) {
+        from = std::max(from, 0.0);
+        to = std::min(to, static_cast<double>(m_width));
+        if(from >= to)
+            return;
+        const auto first = static_cast<int>(from);
+        const auto last = static_cast<int>(to);
+        const auto cover = [](double length) {return static_cast<int>(length * SubCoverage + 0.5);};
+        m_left = std::min(m_left, first);
+        if(first == last) {
+            m_coverage[static_cast<size_t>(first)] += cover(to - from);
+            m_right = std::max(m_right, first + 1);
+            return;
+        }
+        m_coverage[static_cast<size_t>(first)] += cover(first + 1 - from);
+        m_spans[static_cast<size_t>(first) + 1] += SubCoverage;
+        m_spans[static_cast<size_t>(last)] -= SubCoverage;
+        m_coverage[static_cast<size_t>(last)] += cover(to - last);  // last may be m_width, never painted
+        m_right = std::max(m_right, std::min(last + 1, m_width));
+    }
+
+    void paint(int y) {
+        const auto target = m_pixels + static_cast<ptrdiff_t>(y) * m_width;
+        const auto coverage = m_coverage.data();
+        const auto spans = m_spans.data();
+        const auto row = m_row.data();
+        auto sum = 0;
+        for(auto i = m_left; i < m_right; ++i) {
+            sum += spans[i];
+            row[i] = std::min(FullCoverage, coverage[i] + sum);
+        }
+        // span ends are within m_left - m_right, except at the bitmap edge
+        std::fill(coverage + m_left, coverage + m_right + 1, 0);
+        std::fill(spans + m_left, spans + m_right + 1, 0);
+
+        const auto full = m_opaque ? FullCoverage : FullCoverage + 1; // opaque runs replace pixels
+        for(auto i = m_left; i < m_right;) {
+            auto j = i;
+            while(j < m_right && row[j] == full)
+                ++j;
+            if(j > i) {
+                std::fill(target + i, target + j, m_color);
+                i = j;
+                continue;
+            }
+            while(j < m_right && row[j] != 0 && row[j] != full)
+                ++j;
+            if(j == i) {
+                ++i;
+                continue;
+            }
+            const auto count = static_cast<size_t>(j - i);
+            m_source.resize(count);
+            for(size_t k = 0; k < count; ++k)
+                m_source[k] = m_colors[static_cast<size_t>(row[static_cast<size_t>(i) + k])];
+            premultiply_row(target + i, target + i, count);
+            blend_row(BlendMode::SourceOver, m_source.data(), target + i, count);
+            unpremultiply_row(target + i, count);
+            i = j;
+        }
+    }
+
+private:
+    dataT* m_pixels;
+    int m_width;
+    int m_height;
+    std::vector<Edge> m_edges{};
+    std::vector<Crossing> m_crossings{};
+    std::vector<int> m_coverage;
+    std::vector<int> m_spans;
+    std::vector<int> m_row;
+    std::vector<dataT> m_source{};
+    std::array<dataT, FullCoverage + 1> m_colors{};
+    dataT m_color{0};
+    bool m_opaque{false};
+    int m_left{0};
+    int m_right{0};
+};
+
+}
+
+// enough segments to keep the error below a tenth of pixel
+static Contour ellipse(const Point& centre, double rx, double ry, bool reverse) {
+    const auto segments = static_cast<int>(std::ceil(std::clamp(8.0 * std::sqrt(std::max(rx, ry)), 8.0, 1024.0)));
+    Contour contour(static_cast<size_t>(segments));
+    const auto step = (reverse ? -2.0 : 2.0) * std::acos(-1.0) / segments;
+    for(auto i = 0; i < segments; ++i)
+        contour[static_cast<size_t>(i)] = {centre.x + rx * std::cos(i * step), centre.y + ry * std::sin(i * step)};
+    return contour;
+}
+
+// segments and joints wind the same way, so with NonZero rule the overlaps are filled once
+static std::vector<Contour> stroke(const std::vector<Point>& points, double width) {
+    std::vector<Contour> contours;
+    const auto half = width / 2.0;
+    for(size_t i = 0; i + 1 < points.size(); ++i) {
+        const auto& a = points[i];
+        const auto& b = points[i + 1];
+        const auto length = std::hypot(b.x - a.x, b.y - a.y);
+        if(!(length > 0.0))
+            continue;
+        const auto nx = -(b.y - a.y) / length * half;
+        const auto ny = (b.x - a.x) / length * half;
+        contours.push_back({{a.x - nx, a.y - ny}, {b.x - nx, b.y - ny}, {b.x + nx, b.y + ny}, {a.x + nx, a.y + ny}});
+        if(i > 0)
+            contours.push_back(ellipse(a, half, half, false));
+    }
+    return contours;
+}
+
+void Bitmap::draw_line(const Point& from, const Point& to, Color::type color, double width) {
+    draw_polyline({from, to}, color, width);
+}
+
+void Bitmap::draw_polyline(const std::vector<Point>& points, Color::type color, double width) {
+    if(empty() || !(width > 0.0))
+        return;
+    Rasterizer(inner_data(), this->width(), height()).fill(stroke(points, width), color, FillRule::NonZero);
+}
+
+void Bitmap::fill_polygon(const std::vector<Point>& points, Color::type color, FillRule rule) {
+    if(empty())
+        return;
+    Rasterizer(inner_data(), width(), height()).fill({points}, color, rule);
+}
+
+void Bitmap::draw_ellipse(const Point& centre, double rx, double ry, Color::type color, double width) {
+    if(empty() || !(width > 0.0) || !(rx > 0.0) || !(ry > 0.0))
+        return;
+    const auto half = width / 2.0;
+    std::vector<Contour> contours{ellipse(centre, rx + half, ry + half, false)};
+    if(rx > half && ry > half)
+        contours.push_back(ellipse(centre, rx - half, ry - half, true));
+    Rasterizer(inner_data(), this->width(), height()).fill(contours, color, FillRule::NonZero);
+}
+
+void Bitmap::fill_ellipse(const Point& centre, double rx, double ry, Color::type color) {
+    if(empty() || !(rx > 0.0) || !(ry > 0.0))
+        return;
+    Rasterizer(inner_data(), width(), height()).fill({ellipse(centre, rx, ry, false)}, color, FillRule::NonZero);
+}
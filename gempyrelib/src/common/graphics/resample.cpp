@@ -0,0 +1,242 @@
+#include "gempyre_bitmap.h"
+#include "canvas_data.h"
+#include "blend.h"
+#ifndef __EMSCRIPTEN__
+#include "worker_pool.h"
+#endif
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace Gempyre;
+
+static constexpr size_t ParallelPixels = 64 * 1024; // smaller areas are not worth of waking up the workers
+static constexpr unsigned FractionBits = 8;         // fixed point sample positions, as lerp_row weights
+static constexpr unsigned One = 1U << FractionBits;
+
+template<class F>
+static void for_rows(int rows, int width, const F& job) {
+#ifndef __EMSCRIPTEN__
+    if(static_cast<size_t>(rows) * static_cast<size_t>(width) >= ParallelPixels) {
+        WorkerPool::shared().run(static_cast<size_t>(rows), [&job](size_t begin, size_t end, unsigned) {
+            job(static_cast<int>(begin), static_cast<int>(end));
+        });
+        return;
+    }
+#endif
+    job(0, rows);
+}
+
+// two channels at time, the same rounding as lerp_row
+static dataT lerp(dataT p0, dataT p1, unsigned weight) {
+    const auto rb = (((p0 & 0x00FF00FF) * (One - weight) + (p1 & 0x00FF00FF) * weight + 0x00800080) >> 8) & 0x00FF00FF;
+    const auto ga = (((p0 >> 8) & 0x00FF00FF) * (One - weight) + ((p1 >> 8) & 0x00FF00FF) * weight + 0x00800080) & 0xFF00FF00;
+    return rb | ga;
+}
+
+// pixel centres are aligned: target i samples source (i + 0.5) * source_size / target_size - 0.5
+struct Sample {
+    int first;
+    int second;
+    unsigned weight; // of the second
+};
+
+static std::vector<Sample> samples(int target_size, int source_size) {
+    std::vector<Sample> table(static_cast<size_t>(target_size));
+    for(auto i = 0; i < target_size; ++i) {
+        const auto pos = (static_cast<int64_t>(2 * i + 1) * source_size * One) / (2 * target_size) - One / 2;
+        if(pos <= 0) {
+            table[static_cast<size_t>(i)] = {0, 0, 0};
+            continue;
+        }
+        const auto first = static_cast<int>(pos >> FractionBits);
+        if(first >= source_size - 1) {
+            table[static_cast<size_t>(i)] = {source_size - 1, source_size - 1, 0};
+            continue;
+        }
+        table[static_cast<size_t>(i)] = {first, first + 1, static_cast<unsigned>(pos & (One - 1))};
+    }
+    return table;
+}
+
+static void nearest(const BitmapView& source, dataT* target, int width, int height) {
+    std::vector<int> columns(static_cast<size_t>(width));
+    for(auto i = 0; i < width; ++i)
+        columns[static_cast<size_t>(i)] = static_cast<int>((static_cast<int64_t>(2 * i + 1) * source.width()) / (2 * width));
+    for_rows(height, width, [&](int begin, int end) {
+        for(auto j = begin; j < end; ++j) {
+            const auto row = source.row(static_cast<int>((static_cast<int64_t>(2 * j + 1) * source.height()) / (2 * height)));
+            auto out = target + static_cast<ptrdiff_t>(j) * width;
+            for(const auto column : columns)
+                *out++ = row[column];
+        }
+    });
+}
+
+// separable: source rows are interpolated horizontally, then the two rows vertically
+static void bilinear(const BitmapView& source, dataT* target, int width, int height) {
+    const auto columns = samples(width, source.width());
+    const auto rows = samples(height, source.height());
+    for_rows(height, width, [&](int begin, int end) {
+        const auto size = static_cast<size_t>(width);
+        std::vector<dataT> upper(size);
+        std::vector<dataT> lower(size);
+        int upper_row = -1;
+        int lower_row = -1;
+        const auto horizontal = [&columns, &source](int y, std::vector<dataT>& out) {
+            const auto row = source.row(y);
+            auto pos = out.begin();
+            for(const auto& column : columns)
+                *pos++ = lerp(row[column.first], row[column.second], column.weight);
+        };
+        for(auto j = begin; j < end; ++j) {
+            const auto& sample = rows[static_cast<size_t>(j)];
+            if(sample.first == lower_row) { // moving down, previous lower is the upper now
+                upper.swap(lower);
+                std::swap(upper_row, lower_row);
+            }
+            if(sample.first != upper_row) {
+                horizontal(sample.first, upper);
+                upper_row = sample.first;
+            }
+            if(sample.weight > 0 && sample.second != lower_row) {
+                horizontal(sample.second, lower);
+                lower_row = sample.second;
+            }
+            lerp_row(upper.data(), sample.weight > 0 ? lower.data() : upper.data(), target + static_cast<ptrdiff_t>(j) * width, size, sample.weight);
+        }
+    });
+}
+
+// average of source pixels that the target pixel covers
+static void box(const BitmapView& source, dataT* target, int width, int height) {
+    const auto span = [](int i, int target_size, int source_size) {
+        const auto first = static_cast<int>(static_cast<int64_t>(i) * source_size / target_size);
+        const auto last = static_cast<int>(static_cast<int64_t>(i + 1) * source_size / target_size);
+        return std::make_pair(first, std::max(first + 1, last));
+    };
+    std::vector<std::pair<int, int>> columns(static_cast<size_t>(width));
+    for(auto i = 0; i < width; ++i)
+        columns[static_cast<size_t>(i)] = span(i, width, source.width());
+    for_rows(height, width, [&](int begin, int end) {
+        std::vector<uint32_t> sums(static_cast<size_t>(source.width()) * 4);
+        for(auto j = begin; j < end; ++j) {
+            const auto [top, bottom] = span(j, height, source.height());
+            std::fill(sums.begin(), sums.end(), 0);
+            for(auto y = top; y < bottom; ++y) {
+                const auto row = source.row(y);
+                for(auto i = 0; i < source.width(); ++i) {
+                    const auto p = row[i];
+                    auto sum = sums.begin() + 4 * i;
+                    sum[0] += p & 0xFF;
+                    sum[1] += (p >> 8) & 0xFF;
+                    sum[2] += (p >> 16) & 0xFF;
+                    sum[3] += p >> 24;
+                }
+            }
+            auto out = target + static_cast<ptrdiff_t>(j) * width;
+            for(const auto& [left, right] : columns) {
+                uint64_t pixel[4] = {0, 0, 0, 0};
+                for(auto i = left; i < right; ++i)
+                    for(auto c = 0; c < 4; ++c)
+                        pixel[c] += sums[static_cast<size_t>(4 * i + c)];
+                const auto count = static_cast<uint64_t>(right - left) * static_cast<uint64_t>(bottom - top);
+                dataT value = 0;
+                for(auto c = 0; c < 4; ++c)
+                    value |= static_cast<dataT>((pixel[c] + count / 2) / count) << (8 * c);
+                *out++ = value;
+            }
+        }
+    });
+}
+
+Bitmap BitmapView::scaled(int width, int height, Filter filter) const {
+    if(empty() || width <= 0 || height <= 0)
+        return Bitmap{};
+    Bitmap bmp(width, height);
+    if(width == m_width && height == m_height) {
+        bmp.tile(0, 0, *this);
+        return bmp;
+    }
+    const auto target = bmp.inner_data();
+    switch(filter) {
+    case Filter::Nearest:
+        nearest(*this, target, width, height);
+        break;
+    case Filter::Box:
+        if(width < m_width || height < m_height) {
+            box(*this, target, width, height);
+            break;
+        }
+        [[fallthrough]];
+    case Filter::Bilinear:
+        bilinear(*this, target, width, height);
+        break;
+    }
+    return bmp;
+}
+
+Bitmap Bitmap::scaled(int width, int height, Filter filter) const {
+    return BitmapView(*this).scaled(width, height, filter);
+}
+
+void Bitmap::transform(const BitmapView& source, const Transform& transform, Filter filter) {
+    if(empty() || source.empty())
+        return;
+    const auto inverse = transform.inverse();
+    if(!inverse)
+        return;
+    const auto& t = *inverse;
+
+    // only the bounding box of the transformed source is visited
+    double left = width(), top = height(), right = 0, bottom = 0;
+    for(const auto& [x, y] : {std::make_pair(0, 0), std::make_pair(source.width(), 0),
+        std::make_pair(0, source.height()), std::make_pair(source.width(), source.height())}) {
+        const auto tx = transform.a * x + transform.c * y + transform.e;
+        const auto ty = transform.b * x + transform.d * y + transform.f;
+        left = std::min(left, tx);
+        top = std::min(top, ty);
+        right = std::max(right, tx);
+        bottom = std::max(bottom, ty);
+    }
+    const auto x0 = std::max(0, static_cast<int>(std::floor(left)));
+    const auto y0 = std::max(0, static_cast<int>(std::floor(top)));
+    const auto x1 = std::min(width(), static_cast<int>(std::ceil(right)));
+    const auto y1 = std::min(height(), static_cast<int>(std::ceil(bottom)));
+    if(x0 >= x1 || y0 >= y1)
+        return;
+
+    const auto sw = source.width();
+    const auto sh = source.height();
+    const auto stride = width();
+    const auto data = inner_data();
+    const auto smooth = filter != Filter::Nearest;
+    for_rows(y1 - y0, x1 - x0, [&](int begin, int end) {
+        for(auto j = begin; j < end; ++j) {
+            const auto y = y0 + j;
+            // source position of the pixel centre, it moves by (a, b) per pixel
+            auto sx = t.a * (x0 + 0.5) + t.c * (y + 0.5) + t.e;
+            auto sy = t.b * (x0 + 0.5) + t.d * (y + 0.5) + t.f;
+            auto out = data + static_cast<ptrdiff_t>(y) * stride;
+            for(auto x = x0; x < x1; ++x, sx += t.a, sy += t.b) {
+                if(sx < 0 || sy < 0 || sx >= sw || sy >= sh)
+                    continue;
+                if(!smooth) {
+                    out[x] = source.pixel(static_cast<int>(sx), static_cast<int>(sy));
+                    continue;
+                }
+                // rounded to fixed point, so that rounding errors do not spill neighbours on pixel centres
+                const auto fx = std::max(0L, std::lround((sx - 0.5) * One));
+                const auto fy = std::max(0L, std::lround((sy - 0.5) * One));
+                const auto ix = std::min(static_cast<int>(fx >> FractionBits), sw - 1);
+                const auto iy = std::min(static_cast<int>(fy >> FractionBits), sh - 1);
+                const auto wx = static_cast<unsigned>(fx & (One - 1));
+                const auto wy = static_cast<unsigned>(fy & (One - 1));
+                const auto nx = std::min(ix + 1, sw - 1);
+                const auto upper = source.row(iy);
+                const auto lower = source.row(std::min(iy + 1, sh - 1));
+                out[x] = lerp(lerp(upper[ix], upper[nx], wx), lerp(lower[ix], lower[nx], wx), wy);
+            }
+        }
+    });
+}
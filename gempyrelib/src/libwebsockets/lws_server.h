@@ -138,7 +138,7 @@ private:
     bool get_http(lws* wsi, std::string_view get_param);
     void append_socket(lws* wsi);
     bool remove_socket(lws* wsi, unsigned error_code);
-    bool received(lws* wsi, std::string_view msg);
+    bool received(lws* wsi, std::string_view msg, bool is_binary);
     size_t on_write(lws* wsi);
     int on_http(lws *wsi, void* in);
     int on_http_write(lws *wsi);
@@ -206,9 +206,9 @@ bool LWS_Server::remove_socket(lws* wsi, unsigned code) {
 }
 
 
-bool LWS_Server::received(lws* wsi, std::string_view msg) {
-     GempyreUtils::log(GempyreUtils::LogLevel::Debug, "Received", msg.substr(0, 20), msg.size());
-     switch(messageHandler(msg)) {
+bool LWS_Server::received(lws* wsi, std::string_view msg, bool is_binary) {
+     GempyreUtils::log(GempyreUtils::LogLevel::Debug, "Received", is_binary ? "binary" : msg.substr(0, 20), msg.size());
+     switch(is_binary ? binaryHandler(msg) : messageHandler(msg)) {
           case MessageReply::DoNothing:
                if(m_do_close) {
                     return false; // close connection
@@ -275,12 +275,13 @@ int LWS_Server::ws_callback(lws* wsi, lws_callback_reasons reason, void* /*user*
           const auto is_final = lws_is_final_fragment(wsi);
           if (is_final) {
                 bool ok = false;
+                const bool is_binary = lws_frame_is_binary(wsi) != 0;
                 if ( self->m_recv_buffer.empty() ) {
-                    ok = self->received(wsi, std::string_view{data, len});
+                    ok = self->received(wsi, std::string_view{data, len}, is_binary);
                 } else {
                     self->m_recv_buffer.insert( std::end( self->m_recv_buffer ), data, data + len );
                     ok = self->received(wsi,
-                         std::string_view{ self->m_recv_buffer.data(), self->m_recv_buffer.size()});
+                         std::string_view{ self->m_recv_buffer.data(), self->m_recv_buffer.size()}, is_binary);
                     self->m_recv_buffer.clear();
                }
                if (!ok) 
@@ -139,8 +139,7 @@ void Uws_Server::serverThread(unsigned int port) {
         Gempyre::SocketHandler(*this).openHandler(ws);
     };;
     behavior.message =  [this](auto ws, auto message, auto opCode) {
-        (void) opCode;
-        switch(messageHandler(message)) {
+        switch(opCode == uWS::OpCode::BINARY ? binaryHandler(message) : messageHandler(message)) {
             case MessageReply::DoNothing:
                 if(m_doExit) {
                     ws->close();
@@ -324,6 +324,330 @@ TEST_F(TestUi, draw_bitmap_png) {
     timeout(max_image_wait);
 }
 
+TEST_F(TestUi, draw_indexed_bitmap) {
+    MAKE_CANVAS
+    int draws = 0;
+    Gempyre::IndexedBitmap bmp(200, 200);
+    for(auto i = 0; i < 256; ++i)
+        bmp.set_color(static_cast<uint8_t>(i), Gempyre::Color::rgb(static_cast<Gempyre::Color::type>(i), 0, 0));
+    canvas.draw_completed([this, &canvas, &bmp, &draws]() {
+        if(++draws == 3) {
+            test_exit();
+            return;
+        }
+        bmp.set_index(10, 10, 0xFF);
+        canvas.draw(0, 0, bmp);   // second draw does not send the palette
+    });
+    canvas.draw(0, 0, bmp);
+    timeout(max_image_wait);
+}
+
+TEST_F(TestUi, draw_indexed_tiles) {
+    MAKE_CANVAS
+    // canvas has not drawn anything, hence it has no buffers from an earlier draw
+    Gempyre::IndexedBitmap bmp(700, 300);
+    for(auto i = 0; i < 256; ++i)
+        bmp.set_color(static_cast<uint8_t>(i), Gempyre::Color::rgb(0, static_cast<Gempyre::Color::type>(i), 0xFF));
+    for(auto y = 0; y < bmp.height(); ++y)
+        for(auto x = 0; x < bmp.width(); ++x)
+            bmp.set_index(x, y, static_cast<uint8_t>(x / 7 + y));
+    std::optional<Gempyre::Bitmap> read;
+    canvas.draw_completed([this, &canvas, &read]() {
+        read = canvas.read_bitmap({0, 0, 640, 300});
+        test_exit();
+    });
+    canvas.draw(0, 0, bmp);
+    timeout(max_image_wait);
+    ASSERT_TRUE(read);
+    ASSERT_EQ(read->width(), 640);
+    ASSERT_EQ(read->height(), 300);
+    int differ = 0;
+    for(auto y = 0; y < read->height(); ++y)
+        for(auto x = 0; x < read->width(); ++x)
+            differ += read->pixel(x, y) != bmp.pixel(x, y);
+    EXPECT_EQ(differ, 0);
+}
+
+TEST_F(TestUi, draw_indexed_outside) {
+    MAKE_CANVAS
+    Gempyre::IndexedBitmap bmp(20, 20);
+    bmp.set_color(0, Gempyre::Color::Green);
+    int draws = 0;
+    std::optional<Gempyre::Bitmap> read;
+    canvas.draw_completed([this, &canvas, &bmp, &draws, &read]() {
+        if(++draws == 1) {
+            canvas.draw(0, 0, bmp); // palette was not sent by the draw outside
+            return;
+        }
+        read = canvas.read_bitmap({0, 0, 20, 20});
+        test_exit();
+    });
+    canvas.draw(-100, -100, bmp);
+    timeout(max_image_wait);
+    ASSERT_TRUE(read);
+    EXPECT_EQ(read->pixel(10, 10), Gempyre::Color::Green);
+}
+
+TEST_F(TestUi, draw_gray_bitmap) {
+    MAKE_CANVAS
+    Gempyre::GrayBitmap bmp(100, 100);
+    for(auto y = 0; y < bmp.height(); ++y)
+        for(auto x = 0; x < bmp.width(); ++x)
+            bmp.set_pixel(x, y, static_cast<uint8_t>(x + y));
+    std::optional<Gempyre::Bitmap> read;
+    canvas.draw_completed([this, &canvas, &read]() {
+        read = canvas.read_bitmap({0, 0, 100, 100});
+        test_exit();
+    });
+    canvas.draw(0, 0, bmp);
+    timeout(max_image_wait);
+    ASSERT_TRUE(read);
+    const auto expected = bmp.to_bitmap();
+    ASSERT_EQ(read->width(), expected.width());
+    ASSERT_EQ(read->height(), expected.height());
+    EXPECT_EQ(std::memcmp(read->const_data(), expected.const_data(), 100 * 100 * sizeof(Gempyre::Color::type)), 0);
+}
+
+TEST_F(TestUi, on_frame) {
+    MAKE_CANVAS
+    int frames = 0;
+    Gempyre::Bitmap bmp(300, 300, Gempyre::Color::Black);
+    canvas.on_frame([this, &canvas, &bmp, &frames]() {
+        if(++frames == 10) {
+            canvas.on_frame(nullptr);
+            test_exit();
+            return;
+        }
+        bmp.draw_rect({frames * 10, 0, 10, 10}, Gempyre::Color::Red);
+        canvas.draw(0, 0, bmp);
+    });
+    // faster than display, these are held and replaced, not queued
+    ui().start_periodic(1ms, [&canvas, &bmp]() {
+        canvas.draw(0, 0, bmp);
+    });
+    timeout(max_image_wait);
+}
+
+TEST_F(TestUi, on_frame_view) {
+    MAKE_CANVAS
+    int frames = 0;
+    std::vector<Gempyre::Color::type> pixels(300 * 200, Gempyre::Color::Black);
+    const Gempyre::BitmapView view(pixels.data(), 300, 200);
+    canvas.on_frame([this, &canvas, &pixels, &view, &frames]() {
+        if(++frames == 10) {
+            canvas.on_frame(nullptr);
+            test_exit();
+            return;
+        }
+        std::fill(pixels.begin(), pixels.begin() + frames * 300, Gempyre::Color::Red);
+        canvas.draw(0, 0, view);
+    });
+    // held draws of a view are copies of its pixels
+    ui().start_periodic(1ms, [&canvas, &view]() {
+        canvas.draw(0, 0, view);
+    });
+    timeout(max_image_wait);
+    EXPECT_EQ(frames, 10);
+}
+
+TEST_F(TestUi, draw_jpeg) {
+    MAKE_CANVAS
+    canvas.set_compression(Gempyre::CanvasElement::Compression::Jpeg);
+    canvas.set_quality(50);
+    canvas.draw_completed([this]() {
+        test_exit();
+    });
+    Gempyre::Bitmap bmp(700, 500);
+    for(auto j = 0; j < bmp.height(); ++j)
+        for(auto i = 0; i < bmp.width(); ++i)
+            bmp.set_pixel(i, j, Gempyre::Color::rgb(static_cast<Gempyre::Color::type>(i % 256), static_cast<Gempyre::Color::type>(j % 256), 0x80));
+    canvas.draw(0, 0, bmp);
+    timeout(max_image_wait);
+}
+
+TEST_F(TestUi, jpeg_to_lossless) {
+    MAKE_CANVAS
+    canvas.set_compression(Gempyre::CanvasElement::Compression::Jpeg);
+    canvas.set_quality(10);
+    Gempyre::Bitmap bmp(200, 100);
+    for(auto j = 0; j < bmp.height(); ++j)
+        for(auto i = 0; i < bmp.width(); ++i)
+            bmp.set_pixel(i, j, (i / 3 + j / 3) % 2 ? Gempyre::Color::Red : Gempyre::Color::Blue);
+    int draws = 0;
+    std::optional<Gempyre::Bitmap> read;
+    canvas.draw_completed([this, &canvas, &bmp, &draws, &read]() {
+        if(++draws == 1) {
+            // same content is resent, as the client has lossy pixels
+            canvas.set_compression(Gempyre::CanvasElement::Compression::None);
+            canvas.draw(0, 0, bmp);
+            return;
+        }
+        read = canvas.read_bitmap({0, 0, 200, 100});
+        test_exit();
+    });
+    canvas.draw(0, 0, bmp);
+    timeout(max_image_wait);
+    ASSERT_TRUE(read);
+    ASSERT_EQ(read->width(), bmp.width());
+    ASSERT_EQ(read->height(), bmp.height());
+    EXPECT_EQ(std::memcmp(read->const_data(), bmp.const_data(), 200 * 100 * sizeof(Gempyre::Color::type)), 0);
+}
+
+TEST_F(TestUi, blit) {
+    MAKE_CANVAS
+    constexpr auto width = 200;
+    constexpr auto height = 100;
+    int rows = 0;
+    Gempyre::Bitmap row(width, 1, Gempyre::Color::Black);
+    canvas.draw_completed([this, &canvas, &row, &rows]() {
+        if(++rows == 50) {
+            test_exit();
+            return;
+        }
+        canvas.blit({0, 1, width, height - 1}, 0, 0);
+        row.set_pixel(rows, 0, Gempyre::Color::Green);
+        canvas.draw(0, height - 1, row);
+    });
+    canvas.draw(0, 0, Gempyre::Bitmap(width, height, Gempyre::Color::Blue));
+    timeout(max_image_wait);
+}
+
+TEST_F(TestUi, bitmap_image) {
+    MAKE_CANVAS
+    Gempyre::Bitmap sprite(32, 32, Gempyre::Color::Red);
+    sprite.draw_rect({8, 8, 16, 16}, Gempyre::Color::Green);
+    std::string loaded_id;
+    const auto id = canvas.add_image(sprite, [this, &canvas, &loaded_id](std::string_view image) {
+        loaded_id = image;
+        canvas.paint_image(image, 10, 10);
+        Gempyre::FrameComposer fc;
+        fc.draw_image(image, 50, 50);
+        canvas.draw(fc);
+        canvas.remove_image(image);
+        test_exit();
+    });
+    EXPECT_FALSE(id.empty());
+    timeout(max_image_wait);
+    EXPECT_EQ(loaded_id, id);
+}
+
+TEST_F(TestUi, read_bitmap) {
+    MAKE_CANVAS
+    Gempyre::Bitmap bmp(600, 560, Gempyre::Color::Blue);
+    bmp.draw_rect({520, 530, 20, 20}, Gempyre::Color::Red);
+    std::optional<Gempyre::Bitmap> read;
+    canvas.draw_completed([this, &canvas, &read]() {
+        read = canvas.read_bitmap({510, 520, 40, 30});
+        test_exit();
+    });
+    canvas.draw(0, 0, bmp);
+    timeout(max_image_wait);
+    ASSERT_TRUE(read);
+    EXPECT_EQ(read->width(), 40);
+    EXPECT_EQ(read->height(), 30);
+    EXPECT_EQ(Gempyre::Color::b(read->pixel(0, 0)), 0xFFU);
+    EXPECT_EQ(Gempyre::Color::r(read->pixel(15, 15)), 0xFFU);
+}
+
+TEST_F(TestUi, draw_atomic) {
+    MAKE_CANVAS
+    canvas.set_atomic(true);
+    int draws = 0;
+    Gempyre::Bitmap bmp(1500, 1200);
+    canvas.draw_completed([this, &canvas, &bmp, &draws]() {
+        if(++draws == 3) {
+            test_exit();
+            return;
+        }
+        bmp.draw_rect({0, 0, bmp.width(), bmp.height()}, draws == 1 ? Gempyre::Color::Green : Gempyre::Color::Blue);
+        canvas.draw(0, 0, bmp);
+    });
+    bmp.draw_rect({0, 0, bmp.width(), bmp.height()}, Gempyre::Color::Red);
+    canvas.draw(0, 0, bmp);
+    timeout(max_image_wait);
+    EXPECT_EQ(draws, 3);
+}
+
+TEST_F(TestUi, adaptive_quality) {
+    MAKE_CANVAS
+    canvas.set_compression(Gempyre::CanvasElement::Compression::Rle);
+    canvas.set_adaptive_quality(true);
+    const auto state = canvas.quality_state();
+    EXPECT_EQ(state.level, Gempyre::CanvasElement::QualityLevel::Full);
+    EXPECT_EQ(state.compression, Gempyre::CanvasElement::Compression::Rle);
+    EXPECT_EQ(state.scale, 1);
+    int frames = 0;
+    Gempyre::Bitmap bmp(640, 480);
+    canvas.on_frame([this, &canvas, &bmp, &frames]() {
+        if(++frames == 30) {
+            canvas.on_frame(nullptr);
+            test_exit();
+            return;
+        }
+        bmp.draw_rect({0, 0, bmp.width(), bmp.height()}, Gempyre::Color::rgb(static_cast<Gempyre::Color::type>(frames * 8), 0, 0xFF));
+        canvas.draw(0, 0, bmp);
+    });
+    timeout(max_image_wait);
+    EXPECT_EQ(frames, 30);
+}
+
+TEST_F(TestUi, draw_progressive) {
+    MAKE_CANVAS
+    canvas.set_progressive(true);
+    Gempyre::Bitmap bmp(1600, 1280, Gempyre::Color::Blue);
+    bmp.draw_rect({320, 320, 8, 8}, Gempyre::Color::Red);
+    std::optional<Gempyre::Bitmap> read;
+    canvas.draw_completed([this, &canvas, &read]() {
+        read = canvas.read_bitmap({316, 316, 16, 16});
+        test_exit();
+    });
+    canvas.draw(0, 0, bmp);
+    timeout(max_image_wait);
+    // the preview would have blurred the red square
+    ASSERT_TRUE(read);
+    EXPECT_EQ(read->pixel(4, 4), Gempyre::Color::Red);
+    EXPECT_EQ(read->pixel(3, 3), Gempyre::Color::Blue);
+    EXPECT_EQ(read->pixel(12, 12), Gempyre::Color::Blue);
+}
+
+TEST_F(TestUi, draw_view) {
+    MAKE_CANVAS
+    // application framebuffer, only a part of it is drawn
+    const auto width = 200;
+    std::vector<Gempyre::Color::type> frame(width * 100, Gempyre::Color::Blue);
+    std::fill(frame.begin() + 50 * width, frame.end(), Gempyre::Color::Red);
+    std::optional<Gempyre::Bitmap> read;
+    canvas.draw_completed([this, &canvas, &read]() {
+        read = canvas.read_bitmap({0, 0, 20, 20});
+        test_exit();
+    });
+    canvas.draw(0, 0, Gempyre::BitmapView(frame.data(), width, 100).view({0, 40, 20, 20}));
+    timeout(max_image_wait);
+    ASSERT_TRUE(read);
+    EXPECT_EQ(read->pixel(5, 5), Gempyre::Color::Blue);
+    EXPECT_EQ(read->pixel(5, 15), Gempyre::Color::Red);
+}
+
+TEST_F(TestUi, virtual_canvas) {
+    Gempyre::VirtualCanvas map(ui(), ui().root(), 50000, 50000);
+    map.set_style("width", "400px");
+    map.set_style("height", "300px");
+    int tiles = 0;
+    map.set_tile_provider([this, &tiles](const Gempyre::Element::Rect& area, Gempyre::Bitmap& bmp) {
+        EXPECT_EQ(bmp.width(), area.width);
+        EXPECT_EQ(bmp.height(), area.height);
+        bmp.draw_rect({0, 0, area.width, area.height}, Gempyre::Color::Green);
+        if(++tiles == 1)
+            ui().after(1s, [this]() {test_exit();});
+    });
+    timeout(max_image_wait);
+    // only the tiles under the 400 x 300 viewport are provided
+    EXPECT_GT(tiles, 0);
+    EXPECT_LE(tiles, 4);
+    EXPECT_EQ(map.viewport().x, 0);
+    EXPECT_EQ(map.viewport().y, 0);
+}
+
 namespace Gempyre {
 static
 bool operator==(const Gempyre::Bitmap& b1, const Gempyre::Bitmap& b2) {
@@ -381,7 +705,8 @@ TEST(Graphics, bitmap_copy) {
     const auto copied = b;
     EXPECT_EQ(b, copied);
     b.draw_rect({5, 5, 5, 5}, Gempyre::Color::Red);
-    EXPECT_EQ(b, copied);
+    EXPECT_NE(b, copied);   // copy-on-write
+    EXPECT_EQ(copied.pixel(6, 6), Gempyre::Color::Yellow);
 }
 
 TEST(Graphics, bitmap_swap) {
@@ -407,6 +732,27 @@ Gempyre::Bitmap rect(int width, int height, Gempyre::Color::type color) {
     return b;
 }
 
+TEST(Graphics, indexed_bitmap) {
+    Gempyre::IndexedBitmap::Palette palette{};
+    palette[1] = Gempyre::Color::Red;
+    palette[2] = Gempyre::Color::Blue;
+    Gempyre::IndexedBitmap b(20, 10, palette);
+    ASSERT_EQ(b.width(), 20);
+    ASSERT_EQ(b.height(), 10);
+    b.set_index(3, 4, 1);
+    b.set_index(19, 9, 2);
+    ASSERT_EQ(b.index(3, 4), 1);
+    ASSERT_EQ(b.pixel(19, 9), Gempyre::Color::Blue);
+    const auto copy = b;
+    b.set_color(1, Gempyre::Color::Green);
+    ASSERT_EQ(copy.pixel(3, 4), Gempyre::Color::Red);
+    Gempyre::Bitmap expected(20, 10, palette[0]);
+    expected.set_pixel(3, 4, Gempyre::Color::Green);
+    expected.set_pixel(19, 9, Gempyre::Color::Blue);
+    ASSERT_EQ(b.to_bitmap(), expected);
+    ASSERT_TRUE(Gempyre::IndexedBitmap().to_bitmap().empty());
+}
+
 TEST(Graphics, colors) {
     EXPECT_EQ(Gempyre::Color::rgb(Gempyre::Color::Red), std::string("#FF0000"));
     EXPECT_EQ(Gempyre::Color::rgb(Gempyre::Color::Blue), std::string("#0000FF"));
@@ -688,6 +1034,21 @@ TEST(Graphics, to_png) {
     ASSERT_TRUE(std::memcmp(png.data(), png_sig, sizeof(png_sig)) == 0); 
 }
 
+TEST(Graphics, png_options) {
+    auto bmp = rect(100, 100, Gempyre::Color::Blue);
+    bmp.draw_line({0, 0}, {99, 99}, Gempyre::Color::rgba(0xFF, 0, 0, 0x80), 3);
+    for(const auto& options : {Gempyre::PngOptions{0, Gempyre::PngOptions::RowFilter::None, false, false},
+        Gempyre::PngOptions{}, Gempyre::PngOptions{4, Gempyre::PngOptions::RowFilter::MinSum, false, true},
+        Gempyre::PngOptions{9, Gempyre::PngOptions::RowFilter::Paeth, true, true}}) {
+        const auto png = bmp.png_image(options);
+        ASSERT_FALSE(png.empty());
+        const Gempyre::Bitmap decoded(png);
+        ASSERT_EQ(decoded.width(), bmp.width());
+        ASSERT_EQ(decoded.height(), bmp.height());
+        ASSERT_EQ(std::memcmp(decoded.const_data(), bmp.const_data(), static_cast<size_t>(bmp.width() * bmp.height()) * sizeof(Gempyre::Color::type)), 0);
+    }
+}
+
 #ifdef USE_WEBP
 const uint8_t web_sig[] = {'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'E', 'B', 'P'};
 TEST(Graphics, to_webp_one) {
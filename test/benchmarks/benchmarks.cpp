@@ -0,0 +1,76 @@
+#include "gempyre_bitmap.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+
+// Timings that do not belong to the unit tests, build with 'cmake --build . --target benchmarks'
+
+// best of rounds, in microseconds
+template<class Job>
+static auto measure(const Job& job) {
+    auto best = std::chrono::steady_clock::duration::max();
+    for(auto round = 0; round < 5; ++round) {
+        const auto start = std::chrono::steady_clock::now();
+        job();
+        best = std::min(best, std::chrono::steady_clock::now() - start);
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(best).count();
+}
+
+// per pixel calls against the row access
+static bool bitmap_row_access() {
+    const auto width = 1024;
+    const auto height = 1024;
+    const auto color = [](int x, int y) {return Gempyre::Color::rgb(static_cast<Gempyre::Color::type>(x & 0xFF), static_cast<Gempyre::Color::type>(y & 0xFF), 0x80);};
+
+    Gempyre::Bitmap by_pixel(width, height);
+    const auto pixel_time = measure([&]() {
+        for(auto y = 0; y < height; ++y)
+            for(auto x = 0; x < width; ++x)
+                by_pixel.set_pixel(x, y, color(x, y));
+    });
+    Gempyre::Bitmap by_row(width, height);
+    const auto row_time = measure([&]() {
+        auto y = 0;
+        for(auto row : by_row.rows()) {
+            for(auto x = 0; x < width; ++x)
+                row[static_cast<size_t>(x)] = color(x, y);
+            ++y;
+        }
+    });
+    Gempyre::Bitmap by_fill(width, height);
+    const auto fill_pixel_time = measure([&]() {
+        for(auto y = 0; y < height; ++y)
+            for(auto x = 0; x < width; ++x)
+                by_fill.set_pixel(x, y, Gempyre::Color::Red);
+    });
+    const auto fill_row_time = measure([&]() {
+        for(auto y = 0; y < height; ++y)
+            by_fill.fill_row(0, y, width, Gempyre::Color::Red);
+    });
+
+    // results are used, so that the loops are not optimized away
+    std::uint64_t pixel_sum = 0, row_sum = 0;
+    for(auto y = 0; y < height; ++y) {
+        const auto a = by_pixel.const_row(y);
+        const auto b = by_row.const_row(y);
+        pixel_sum = std::accumulate(a.begin(), a.end(), pixel_sum);
+        row_sum = std::accumulate(b.begin(), b.end(), row_sum);
+    }
+    std::cout << "Bitmap " << width << "x" << height << "\n"
+              << "  set_pixel:      " << pixel_time << "us\n"
+              << "  rows:           " << row_time << "us\n"
+              << "  set_pixel fill: " << fill_pixel_time << "us\n"
+              << "  fill_row:       " << fill_row_time << "us" << std::endl;
+    return pixel_sum == row_sum;
+}
+
+int main() {
+    if(!bitmap_row_access()) {
+        std::cerr << "Row access differs from set_pixel" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -5,6 +5,12 @@
 #include "gempyre.h"
 #include "gempyre_graphics.h"
 #include "timequeue.h"
+#include "canvas_state.h"
+#include "canvas_codec.h"
+#include "jpeg_encoder.h"
+#include "worker_pool.h"
+#include "quality_controller.h"
+#include "canvas_data.h"
 
 TEST(Unittests, has_true) {
     std::unordered_map<std::string, std::string> v1 {{"foo", "true"}};
@@ -776,6 +782,795 @@ TEST(Unittests, get_distinct_color_hsv) {
 }
 
 
+TEST(Unittests, tile_cache) {
+    std::vector<Gempyre::dataT> pixels(100 * 50, Gempyre::Color::Red);
+    const auto h1 = Gempyre::TileCache::hash(pixels.data(), 100, 100, 50);
+    EXPECT_EQ(h1, Gempyre::TileCache::hash(pixels.data(), 100, 100, 50));
+    pixels[77 + 33 * 100] = Gempyre::Color::Blue;
+    const auto h2 = Gempyre::TileCache::hash(pixels.data(), 100, 100, 50);
+    EXPECT_NE(h1, h2);
+    EXPECT_NE(h2, Gempyre::TileCache::hash(pixels.data(), 100, 99, 50));
+    EXPECT_EQ(Gempyre::TileCache::hash(pixels.data(), 100, 50, 50), Gempyre::TileCache::hash(pixels.data(), 100, 50, 50));
+    EXPECT_NE(Gempyre::TileCache::hash(pixels.data(), 100, 50, 50), Gempyre::TileCache::hash(pixels.data() + 50, 100, 50, 50));
+
+    Gempyre::TileCache cache;
+    EXPECT_FALSE(cache.contains({0, 0, 100, 50}, h1));
+    cache.store({0, 0, 100, 50}, h1);
+    cache.store({100, 0, 100, 50}, h1);
+    EXPECT_TRUE(cache.contains({0, 0, 100, 50}, h1));
+    EXPECT_FALSE(cache.contains({0, 0, 100, 50}, h2));
+    EXPECT_FALSE(cache.contains({0, 0, 100, 51}, h1));
+    EXPECT_EQ(cache.size(), 2U);
+    cache.store({0, 0, 100, 50}, h2);
+    EXPECT_TRUE(cache.contains({0, 0, 100, 50}, h2));
+    EXPECT_FALSE(cache.contains({0, 0, 100, 50}, h1));
+    EXPECT_EQ(cache.size(), 2U);
+    // overlapping draw overwrites both
+    cache.store({50, 10, 100, 10}, h1);
+    EXPECT_EQ(cache.size(), 1U);
+    EXPECT_FALSE(cache.contains({100, 0, 100, 50}, h1));
+    cache.invalidate({0, 0, 1, 1});
+    EXPECT_EQ(cache.size(), 1U);
+    cache.invalidate({149, 19, 1, 1});
+    EXPECT_TRUE(cache.empty());
+}
+
+
+TEST(Unittests, tile_references) {
+    std::vector<Gempyre::dataT> pixels(100 * 50, Gempyre::Color::Red);
+    Gempyre::TileReferences refs;
+    EXPECT_EQ(refs.find({0, 0, 10, 10}), nullptr);
+    const auto s1 = refs.store({0, 0, 10, 10}, pixels.data() + 5, 100, 10, 10);
+    const auto r1 = refs.find({0, 0, 10, 10});
+    ASSERT_NE(r1, nullptr);
+    EXPECT_EQ(r1->serial, s1);
+    EXPECT_EQ(r1->words.size(), 100U);
+    EXPECT_EQ(r1->words[99], Gempyre::Color::Red);
+    EXPECT_EQ(refs.find({0, 0, 10, 11}), nullptr);
+    pixels[5] = Gempyre::Color::Blue;
+    const auto s2 = refs.store({0, 0, 10, 10}, pixels.data() + 5, 100, 10, 10);
+    EXPECT_NE(s1, s2);
+    EXPECT_EQ(refs.find({0, 0, 10, 10})->words[0], Gempyre::Color::Blue);
+    refs.store({10, 0, 10, 10}, pixels.data(), 100, 10, 10);
+    EXPECT_EQ(refs.size(), 2U);
+    // overlapping reference is dropped
+    refs.store({5, 5, 10, 10}, pixels.data(), 100, 10, 10);
+    EXPECT_EQ(refs.size(), 1U);
+    EXPECT_EQ(refs.find({0, 0, 10, 10}), nullptr);
+    refs.clear();
+    EXPECT_EQ(refs.size(), 0U);
+}
+
+TEST(Unittests, data_pool) {
+    Gempyre::DataPool pool(2);
+    auto d1 = pool.acquire(100, 0xAAA, "canvas", {1, 2, 10, 10, 0});
+    EXPECT_EQ(d1->elements(), 100U);
+    EXPECT_EQ(d1->owner(), "canvas");
+    EXPECT_EQ(d1->header(), (std::vector<Gempyre::dataT>{1, 2, 10, 10, 0}));
+    const Gempyre::Data reference(100, 0xAAA, "canvas", {1, 2, 10, 10, 0});
+    EXPECT_EQ(d1->size(), reference.size());
+    auto d2 = pool.acquire(100, 0xAAA, "canvas", {0, 0, 10, 10, 0});
+    EXPECT_NE(d1.get(), d2.get()); // d1 is still in use
+    EXPECT_EQ(pool.allocations(), 2U);
+    const auto p1 = d1.get();
+    d1.reset(); // released e.g. by broadcaster
+    auto d3 = pool.acquire(50, 0xAAA, "foo", {3, 4, 5, 10, 1});
+    EXPECT_EQ(d3.get(), p1);
+    EXPECT_EQ(pool.allocations(), 2U);
+    EXPECT_EQ(d3->elements(), 50U);
+    EXPECT_EQ(d3->owner(), "foo");
+    EXPECT_EQ(d3->header(), (std::vector<Gempyre::dataT>{3, 4, 5, 10, 1}));
+    d3.reset();
+    // too small is replaced
+    auto d4 = pool.acquire(200, 0xAAA, "canvas", {0, 0, 20, 10, 0});
+    EXPECT_EQ(pool.allocations(), 3U);
+    EXPECT_EQ(pool.size(), 2U);
+    // pool is full, still works
+    auto d5 = pool.acquire(200, 0xAAA, "canvas", {0, 0, 20, 10, 0});
+    EXPECT_EQ(pool.allocations(), 4U);
+    EXPECT_EQ(pool.size(), 2U);
+    // steady state
+    d2.reset();
+    d4.reset();
+    for(auto i = 0; i < 10; ++i) {
+        auto d = pool.acquire(200, 0xAAA, "canvas", {0, 0, 20, 10, 0});
+        std::fill(d->begin(), d->end(), Gempyre::Color::Red);
+    }
+    EXPECT_EQ(pool.allocations(), 4U);
+}
+
+TEST(Unittests, tile_codec) {
+    using Codec = Gempyre::TileEncoder::Codec;
+    using Compression = Gempyre::CanvasElement::Compression;
+    constexpr int stride = 120;
+    constexpr int width = 100;
+    constexpr int height = 60;
+    std::vector<Gempyre::dataT> flat(stride * height, Gempyre::Color::White);
+    for(auto i = 10; i < 20; ++i)
+        flat[static_cast<size_t>(i + 30 * stride)] = Gempyre::Color::rgba(static_cast<uint32_t>(i), 0, 0);
+    std::vector<Gempyre::dataT> noise(stride * height);
+    uint32_t seed = 12345;
+    for(auto& p : noise) {
+        seed = seed * 1664525U + 1013904223U;
+        p = seed;
+    }
+    const auto roundtrip = [&](Gempyre::TileEncoder& encoder, const std::vector<Gempyre::dataT>& src, Codec expected) {
+        encoder.clear();
+        const auto encoded = encoder.encode(src.data(), stride, width, height);
+        EXPECT_EQ(encoded.codec, expected);
+        if(encoded.codec == Codec::Raw)
+            return;
+        EXPECT_LT(encoded.bytes, static_cast<size_t>(width * height * 4));
+        std::vector<Gempyre::dataT> out(width * height);
+        EXPECT_TRUE(Gempyre::TileEncoder::decode(encoded.codec, encoder.data() + encoded.offset, encoded.bytes, out.data(), out.size()));
+        for(auto j = 0; j < height; ++j)
+            for(auto i = 0; i < width; ++i)
+                ASSERT_EQ(out[static_cast<size_t>(i + j * width)], src[static_cast<size_t>(i + j * stride)]);
+    };
+    Gempyre::TileEncoder encoder;
+    roundtrip(encoder, flat, Codec::Raw);
+    encoder.set_compression(Compression::Rle);
+    roundtrip(encoder, flat, Codec::Rle);
+    roundtrip(encoder, noise, Codec::Raw);
+    encoder.set_compression(Compression::Deflate);
+    roundtrip(encoder, flat, Codec::Deflate);
+    roundtrip(encoder, noise, Codec::Raw);
+    encoder.set_compression(Compression::Adaptive);
+    roundtrip(encoder, flat, Codec::Rle);
+    roundtrip(encoder, noise, Codec::Raw);
+
+    std::vector<Gempyre::dataT> out(4);
+    const std::vector<Gempyre::dataT> broken{0x80000005, 1};
+    EXPECT_FALSE(Gempyre::TileEncoder::decode(Codec::Rle, broken.data(), broken.size() * 4, out.data(), out.size()));
+}
+
+TEST(Unittests, jpeg_encoder) {
+    constexpr int width = 100;
+    constexpr int height = 70;
+    std::vector<Gempyre::dataT> pixels(width * height);
+    for(auto j = 0; j < height; ++j)
+        for(auto i = 0; i < width; ++i)
+            pixels[static_cast<size_t>(i + j * width)] = Gempyre::Color::rgb(static_cast<uint32_t>(i * 2), static_cast<uint32_t>(j * 3), 0x80);
+    const auto encode = [&](int quality) {
+        Gempyre::JpegEncoder encoder(quality);
+        std::vector<unsigned char> out;
+        const auto bytes = encoder.encode(pixels.data(), width, width, height, out);
+        EXPECT_EQ(bytes, out.size());
+        EXPECT_EQ(out[0], 0xFF);
+        EXPECT_EQ(out[1], 0xD8); // SOI
+        EXPECT_EQ(out[bytes - 2], 0xFF);
+        EXPECT_EQ(out[bytes - 1], 0xD9); // EOI
+        return bytes;
+    };
+    const auto low = encode(20);
+    const auto high = encode(95);
+    EXPECT_LT(low, high);
+    EXPECT_LT(high, pixels.size() * sizeof(Gempyre::dataT));
+
+    Gempyre::TileEncoder encoder;
+    encoder.set_compression(Gempyre::CanvasElement::Compression::Jpeg);
+    const auto encoded = encoder.encode(pixels.data(), width, width, height);
+    EXPECT_EQ(encoded.codec, Gempyre::TileEncoder::Codec::Jpeg);
+}
+
+TEST(Unittests, canvas_handle) {
+    Gempyre::CanvasState s1;
+    Gempyre::CanvasState s2;
+    EXPECT_NE(s1.handle, 0U);
+    EXPECT_NE(s1.handle, s2.handle);
+    Gempyre::DataPool pool;
+    auto d = pool.acquire(10, Gempyre::CanvasData::versioned(Gempyre::CanvasData::CanvasFrameId), Gempyre::CanvasData::NO_ID, {s1.handle, 1, 2, 3, 4, 1});
+    EXPECT_FALSE(d->has_owner());
+    EXPECT_EQ(d->header().front(), s1.handle);
+    EXPECT_EQ(d->size(), (4 + 10 + 6) * sizeof(Gempyre::dataT)); // no id
+}
+
+TEST(Unittests, worker_pool) {
+    Gempyre::WorkerPool pool(4);
+    EXPECT_EQ(pool.size(), 4U);
+    for(const auto count : {1U, 3U, 4U, 1000U}) {
+        std::vector<int> visits(count, 0);
+        std::vector<unsigned> slots(count, 0);
+        pool.run(count, [&](size_t begin, size_t end, unsigned slot) {
+            EXPECT_LT(slot, pool.size());
+            for(auto k = begin; k < end; ++k) {
+                ++visits[k];
+                slots[k] = slot;
+            }
+        });
+        EXPECT_TRUE(std::all_of(visits.begin(), visits.end(), [](auto v) {return v == 1;}));
+        EXPECT_TRUE(std::is_sorted(slots.begin(), slots.end())); // ranges are contiguous
+    }
+    EXPECT_THROW(pool.run(10, [](size_t begin, size_t, unsigned) {
+        if(begin > 0)
+            throw std::runtime_error("job");
+    }), std::runtime_error);
+    int sum = 0;
+    pool.run(1, [&sum](size_t, size_t, unsigned) {++sum;});
+    EXPECT_EQ(sum, 1);
+}
+
+// late workers of a previous run must not take chunks of the next one, that would hang run
+TEST(Unittests, worker_pool_stress) {
+    Gempyre::WorkerPool pool(3);
+    std::atomic<size_t> total{0};
+    for(auto round = 0; round < 20000; ++round) {
+        pool.run(3, [&total](size_t begin, size_t end, unsigned) {
+            total += end - begin;
+        });
+    }
+    EXPECT_EQ(total.load(), 3U * 20000U);
+}
+
+TEST(Unittests, quality_controller) {
+    using Level = Gempyre::CanvasElement::QualityLevel;
+    using Compression = Gempyre::CanvasElement::Compression;
+    Gempyre::QualityController controller(Compression::Rle);
+    auto now = std::chrono::steady_clock::now();
+    Gempyre::QualityController::Sample sample{0, 5, 2, 0ms, 0, 0ms};
+    EXPECT_FALSE(controller.update(sample, now)); // earlier counts do not matter
+    now += 1s;
+    EXPECT_FALSE(controller.update(sample, now));
+    EXPECT_EQ(controller.state().level, Level::Full);
+    EXPECT_EQ(controller.state().compression, Compression::Rle);
+
+    ++sample.backpressure;
+    now += 1s;
+    EXPECT_TRUE(controller.update(sample, now));
+    EXPECT_EQ(controller.state().level, Level::Compressed);
+    EXPECT_EQ(controller.state().compression, Compression::Adaptive);
+    sample.queued_bytes = 64 * 1024 * 1024;
+    EXPECT_FALSE(controller.update(sample, now + 10ms)); // not yet decided again
+    for(const auto level : {Level::Lossy, Level::HalfResolution, Level::SkipFrames}) {
+        now += 1s;
+        EXPECT_TRUE(controller.update(sample, now));
+        EXPECT_EQ(controller.state().level, level);
+    }
+    now += 1s;
+    EXPECT_FALSE(controller.update(sample, now)); // lowest already
+    EXPECT_EQ(controller.state().compression, Compression::Jpeg);
+    EXPECT_EQ(controller.state().scale, 2);
+    EXPECT_TRUE(controller.state().skip_frames);
+    EXPECT_NE(controller.skip(), controller.skip()); // every other
+
+    sample.queued_bytes = 0;
+    now += 500ms;
+    EXPECT_FALSE(controller.update(sample, now)); // calm, but not long enough
+    now += Gempyre::QualityController::RestoreDelay;
+    EXPECT_TRUE(controller.update(sample, now));
+    EXPECT_EQ(controller.state().level, Level::HalfResolution);
+    EXPECT_FALSE(controller.skip());
+    EXPECT_EQ(controller.state().reason, "headroom");
+    for(int i = 0; i < 3; ++i) {
+        now += Gempyre::QualityController::RestoreDelay;
+        EXPECT_TRUE(controller.update(sample, now));
+    }
+    EXPECT_EQ(controller.state().level, Level::Full);
+    EXPECT_EQ(controller.state().scale, 1);
+    EXPECT_EQ(controller.state().compression, Compression::Rle);
+
+    sample.outstanding = Gempyre::QualityController::MaxOutstanding + 1;
+    now += 1s;
+    EXPECT_TRUE(controller.update(sample, now));
+    EXPECT_EQ(controller.state().reason, "frames not acknowledged");
+    controller.set_base(Compression::Deflate);
+    EXPECT_EQ(controller.state().compression, Compression::Deflate);
+}
+
+TEST(Unittests, quality_restore_resends) {
+    using Level = Gempyre::CanvasElement::QualityLevel;
+    using Compression = Gempyre::CanvasElement::Compression;
+    Gempyre::CanvasState state;
+    state.controller = Gempyre::QualityController(Compression::Rle);
+    const Gempyre::Rect tile{0, 0, 64, 64};
+    auto now = std::chrono::steady_clock::now();
+    Gempyre::QualityController::Sample sample{64 * 1024 * 1024, 0, 0, 0ms, 0, 0ms};
+    state.adapt_quality(sample, now);
+    while(state.controller.state().level != Level::Lossy) {
+        now += 1s;
+        ASSERT_TRUE(state.adapt_quality(sample, now));
+    }
+    state.tiles.store(tile, 1); // sent lossy
+    now += 1s;
+    ASSERT_TRUE(state.adapt_quality(sample, now));
+    EXPECT_TRUE(state.tiles.contains(tile, 1)); // still lossy
+
+    sample.queued_bytes = 0;
+    while(state.controller.state().compression == Compression::Jpeg) {
+        now += Gempyre::QualityController::RestoreDelay;
+        ASSERT_TRUE(state.adapt_quality(sample, now));
+    }
+    EXPECT_FALSE(state.tiles.contains(tile, 1)); // unchanged tile is resent in full quality
+    state.tiles.store(tile, 1);
+    while(state.controller.state().level != Level::Full) {
+        now += Gempyre::QualityController::RestoreDelay;
+        ASSERT_TRUE(state.adapt_quality(sample, now));
+    }
+    EXPECT_TRUE(state.tiles.contains(tile, 1)); // lossless codecs do not matter
+}
+
+TEST(Unittests, bitmap_merge) {
+    // widths with a tail that is not vectorized
+    for(const auto width : {1, 7, 37}) {
+        Gempyre::Bitmap target(width, 3);
+        Gempyre::Bitmap source(width, 3);
+        uint32_t seed = 1;
+        const auto random = [&seed]() {seed = seed * 1664525 + 1013904223; return seed;};
+        for(auto j = 0; j < 3; ++j) {
+            for(auto i = 0; i < width; ++i) {
+                target.set_pixel(i, j, random());
+                source.set_pixel(i, j, random());
+            }
+        }
+        const auto original = target.clone();
+        target.merge(0, 0, source);
+        for(auto j = 0; j < 3; ++j) {
+            for(auto i = 0; i < width; ++i) {
+                const auto p = original.pixel(i, j);
+                const auto po = source.pixel(i, j);
+                const auto ao = Gempyre::Color::alpha(po);
+                const auto mix = [ao](auto c, auto co) {return (c * (0xFF - ao) + co * ao) / 0xFF;};
+                const auto expected = Gempyre::Color::rgba_clamped(
+                    mix(Gempyre::Color::r(p), Gempyre::Color::r(po)),
+                    mix(Gempyre::Color::g(p), Gempyre::Color::g(po)),
+                    mix(Gempyre::Color::b(p), Gempyre::Color::b(po)),
+                    Gempyre::Color::alpha(p) + ao);
+                ASSERT_EQ(target.pixel(i, j), expected) << i << "," << j;
+            }
+        }
+    }
+}
+
+TEST(Unittests, bitmap_blend) {
+    using Gempyre::BlendMode;
+    const auto width = 37;
+    Gempyre::Bitmap source(width, 2);
+    Gempyre::Bitmap target(width, 2);
+    for(auto i = 0; i < width; ++i) {
+        const auto a = static_cast<Gempyre::Color::type>(i * 7);
+        source.set_pixel(i, 0, Gempyre::Color::rgba(0xFF, 0x80, 0, a));
+        source.set_pixel(i, 1, Gempyre::Color::rgba(0, 0, 0xFF, 0xFF - a));
+        target.set_pixel(i, 0, Gempyre::Color::rgba(0, 0, 0xFF, 0xFF));
+        target.set_pixel(i, 1, Gempyre::Color::rgba(0x40, 0x40, 0x40, a));
+    }
+    source.premultiply();
+    target.premultiply();
+    // premultiplied: result = source * Fs + target * Ft, components rounded
+    const auto check = [&](BlendMode mode, auto fs, auto ft) {
+        auto result = target.clone();
+        result.blend(0, 0, source, mode, true);
+        for(auto j = 0; j < 2; ++j) {
+            for(auto i = 0; i < width; ++i) {
+                const auto s = source.pixel(i, j);
+                const auto t = target.pixel(i, j);
+                const auto sa = Gempyre::Color::alpha(s);
+                const auto ta = Gempyre::Color::alpha(t);
+                const auto f = [](auto c, auto factor) {return (c * factor + 127) / 255;};
+                const auto c = [&](auto sc, auto tc) {return f(sc, fs(sa, ta)) + f(tc, ft(sa, ta));};
+                const auto expected = Gempyre::Color::rgba_clamped(
+                    c(Gempyre::Color::r(s), Gempyre::Color::r(t)),
+                    c(Gempyre::Color::g(s), Gempyre::Color::g(t)),
+                    c(Gempyre::Color::b(s), Gempyre::Color::b(t)),
+                    c(sa, ta));
+                ASSERT_EQ(result.pixel(i, j), expected) << static_cast<int>(mode) << ":" << i << "," << j;
+            }
+        }
+    };
+    const auto one = [](auto, auto) {return 0xFFU;};
+    const auto zero = [](auto, auto) {return 0U;};
+    const auto src_alpha = [](auto sa, auto) {return sa;};
+    const auto inv_src_alpha = [](auto sa, auto) {return 0xFF - sa;};
+    const auto dst_alpha = [](auto, auto ta) {return ta;};
+    const auto inv_dst_alpha = [](auto, auto ta) {return 0xFF - ta;};
+    check(BlendMode::SourceOver, one, inv_src_alpha);
+    check(BlendMode::DestinationOver, inv_dst_alpha, one);
+    check(BlendMode::SourceIn, dst_alpha, zero);
+    check(BlendMode::DestinationIn, zero, src_alpha);
+    check(BlendMode::DestinationOut, zero, inv_src_alpha);
+    check(BlendMode::DestinationAtop, inv_dst_alpha, src_alpha);
+    check(BlendMode::SourceAtop, dst_alpha, inv_src_alpha);
+    check(BlendMode::Xor, inv_dst_alpha, inv_src_alpha);
+    check(BlendMode::Add, one, one);
+
+    // opaque straight alpha bitmaps are not changed by the conversions
+    Gempyre::Bitmap opaque(width, 1, Gempyre::Color::rgba(10, 20, 30, 0xFF));
+    Gempyre::Bitmap half(width, 1, Gempyre::Color::rgba(0xFF, 0, 0, 0x80));
+    opaque.blend(0, 0, half, BlendMode::SourceOver);
+    EXPECT_EQ(opaque.pixel(width - 1, 0), Gempyre::Color::rgba(133, 10, 15, 0xFF));
+    opaque.blend(0, 0, Gempyre::Bitmap(width, 1, Gempyre::Color::White), BlendMode::Multiply);
+    EXPECT_EQ(opaque.pixel(0, 0), Gempyre::Color::rgba(133, 10, 15, 0xFF));
+    auto round_trip = opaque.clone();
+    round_trip.premultiply();
+    round_trip.unpremultiply();
+    EXPECT_EQ(round_trip.pixel(3, 0), opaque.pixel(3, 0));
+
+    // faint straight alpha color would not survive a round trip, Destination keeps it
+    Gempyre::Bitmap faint(width, 1, Gempyre::Color::rgba(200, 100, 50, 3));
+    faint.blend(0, 0, half, BlendMode::Destination);
+    EXPECT_EQ(faint.pixel(0, 0), Gempyre::Color::rgba(200, 100, 50, 3));
+}
+
+TEST(Unittests, bitmap_view) {
+    // external buffer with padding at the end of rows
+    const auto stride = 12;
+    std::vector<Gempyre::Color::type> frame(stride * 8, Gempyre::Color::Black);
+    for(auto j = 0; j < 8; ++j)
+        for(auto i = 0; i < 10; ++i)
+            frame[static_cast<size_t>(i + j * stride)] = Gempyre::Color::rgba(static_cast<Gempyre::Color::type>(i), static_cast<Gempyre::Color::type>(j), 0);
+    const Gempyre::BitmapView view(frame.data(), 10, 8, stride);
+    EXPECT_EQ(view.width(), 10);
+    EXPECT_EQ(view.stride(), stride);
+    EXPECT_EQ(view.pixel(9, 7), Gempyre::Color::rgba(9, 7, 0));
+
+    const auto part = view.view({-2, 3, 6, 100});
+    EXPECT_EQ(part.width(), 4);
+    EXPECT_EQ(part.height(), 5);
+    EXPECT_EQ(part.pixel(0, 0), Gempyre::Color::rgba(0, 3, 0));
+    EXPECT_TRUE(view.view({10, 0, 5, 5}).empty());
+
+    Gempyre::Bitmap bmp(6, 6, Gempyre::Color::White);
+    bmp.tile(2, 1, part);
+    EXPECT_EQ(bmp.pixel(1, 1), Gempyre::Color::White);
+    EXPECT_EQ(bmp.pixel(2, 1), Gempyre::Color::rgba(0, 3, 0));
+    EXPECT_EQ(bmp.pixel(5, 5), Gempyre::Color::rgba(3, 7, 0));
+
+    const auto copy = Gempyre::BitmapView(bmp, {2, 1, 2, 2}).to_bitmap();
+    EXPECT_EQ(copy.width(), 2);
+    EXPECT_EQ(copy.pixel(1, 1), Gempyre::Color::rgba(1, 4, 0));
+    const auto clipped = bmp.clip({4, 4, 10, 10});
+    EXPECT_EQ(clipped.width(), 2);
+    EXPECT_EQ(clipped.pixel(1, 1), bmp.pixel(5, 5));
+
+    Gempyre::Bitmap target(4, 4, Gempyre::Color::Red);
+    target.merge(-1, -1, part);
+    EXPECT_EQ(target.pixel(0, 0), part.pixel(1, 1));
+}
+
+TEST(Unittests, bitmap_scale) {
+    // big enough to be done in parallel
+    const auto solid = Gempyre::Bitmap(300, 200, Gempyre::Color::rgba(10, 20, 30, 40));
+    for(const auto filter : {Gempyre::Filter::Nearest, Gempyre::Filter::Bilinear, Gempyre::Filter::Box}) {
+        const auto up = solid.scaled(500, 400, filter);
+        EXPECT_EQ(up.width(), 500);
+        EXPECT_EQ(up.height(), 400);
+        EXPECT_EQ(up.pixel(0, 0), solid.pixel(0, 0));
+        EXPECT_EQ(up.pixel(499, 399), solid.pixel(0, 0));
+        const auto down = solid.scaled(7, 3, filter);
+        EXPECT_EQ(down.pixel(6, 2), solid.pixel(0, 0));
+    }
+    EXPECT_TRUE(solid.scaled(0, 10).empty());
+
+    Gempyre::Bitmap bmp(4, 2);
+    for(auto i = 0; i < 4; ++i) {
+        bmp.set_pixel(i, 0, Gempyre::Color::rgba(static_cast<Gempyre::Color::type>(i * 40), 0, 200, 255));
+        bmp.set_pixel(i, 1, Gempyre::Color::rgba(static_cast<Gempyre::Color::type>(i * 40 + 20), 100, 0, 255));
+    }
+    const auto box = bmp.scaled(2, 1, Gempyre::Filter::Box);
+    EXPECT_EQ(box.pixel(0, 0), Gempyre::Color::rgba(30, 50, 100, 255));
+    EXPECT_EQ(box.pixel(1, 0), Gempyre::Color::rgba(110, 50, 100, 255));
+    const auto nearest = bmp.scaled(8, 4, Gempyre::Filter::Nearest);
+    EXPECT_EQ(nearest.pixel(2, 1), bmp.pixel(1, 0));
+    EXPECT_EQ(nearest.pixel(3, 2), bmp.pixel(1, 1));
+    // pixel centres are aligned, middle is halfway between the rows
+    const auto bilinear = bmp.scaled(4, 3, Gempyre::Filter::Bilinear);
+    EXPECT_EQ(bilinear.pixel(1, 0), bmp.pixel(1, 0));
+    EXPECT_EQ(bilinear.pixel(1, 1), Gempyre::Color::rgba(50, 50, 100, 255));
+    EXPECT_EQ(bilinear.pixel(1, 2), bmp.pixel(1, 1));
+    EXPECT_EQ(Gempyre::BitmapView(bmp, {2, 0, 2, 2}).scaled(1, 1, Gempyre::Filter::Box).pixel(0, 0), Gempyre::Color::rgba(110, 50, 100, 255));
+}
+
+TEST(Unittests, bitmap_transform) {
+    const auto t = Gempyre::Transform::translate(3, 4) * Gempyre::Transform::scale(2, 2);
+    const auto inverse = t.inverse();
+    ASSERT_TRUE(inverse);
+    const auto round = t * *inverse;
+    EXPECT_NEAR(round.a, 1, 1e-9);
+    EXPECT_NEAR(round.e, 0, 1e-9);
+    EXPECT_FALSE(Gempyre::Transform::scale(0, 1).inverse());
+
+    Gempyre::Bitmap source(2, 2);
+    source.set_pixel(0, 0, Gempyre::Color::Red);
+    source.set_pixel(1, 0, Gempyre::Color::Green);
+    source.set_pixel(0, 1, Gempyre::Color::Blue);
+    source.set_pixel(1, 1, Gempyre::Color::White);
+
+    Gempyre::Bitmap target(8, 8, Gempyre::Color::Black);
+    target.transform(source, t, Gempyre::Filter::Nearest);
+    EXPECT_EQ(target.pixel(2, 3), Gempyre::Color::Black);
+    EXPECT_EQ(target.pixel(3, 4), Gempyre::Color::Red);
+    EXPECT_EQ(target.pixel(4, 5), Gempyre::Color::Red);
+    EXPECT_EQ(target.pixel(5, 4), Gempyre::Color::Green);
+    EXPECT_EQ(target.pixel(6, 7), Gempyre::Color::White);
+    EXPECT_EQ(target.pixel(7, 7), Gempyre::Color::Black);
+
+    // quarter turn around the origin, moved back into the bitmap
+    Gempyre::Bitmap rotated(2, 2, Gempyre::Color::Black);
+    rotated.transform(source, Gempyre::Transform::translate(2, 0) * Gempyre::Transform::rotate(std::acos(0.0)));
+    EXPECT_EQ(rotated.pixel(1, 0), Gempyre::Color::Red);
+    EXPECT_EQ(rotated.pixel(1, 1), Gempyre::Color::Green);
+    EXPECT_EQ(rotated.pixel(0, 0), Gempyre::Color::Blue);
+    EXPECT_EQ(rotated.pixel(0, 1), Gempyre::Color::White);
+}
+
+TEST(Unittests, bitmap_raster) {
+    Gempyre::Bitmap bmp(20, 20, Gempyre::Color::White);
+    bmp.fill_polygon({{2, 2}, {6, 2}, {6, 6}, {2, 6}}, Gempyre::Color::Red);
+    EXPECT_EQ(bmp.pixel(2, 2), Gempyre::Color::Red);
+    EXPECT_EQ(bmp.pixel(5, 5), Gempyre::Color::Red);
+    EXPECT_EQ(bmp.pixel(6, 5), Gempyre::Color::White);
+    EXPECT_EQ(bmp.pixel(1, 2), Gempyre::Color::White);
+
+    // edge covers half of the pixel
+    bmp.fill_polygon({{10.5, 2}, {14, 2}, {14, 6}, {10.5, 6}}, Gempyre::Color::Red);
+    EXPECT_EQ(Gempyre::Color::r(bmp.pixel(10, 3)), 0xFF);
+    EXPECT_NEAR(static_cast<int>(Gempyre::Color::g(bmp.pixel(10, 3))), 0x80, 1);
+    EXPECT_EQ(bmp.pixel(11, 3), Gempyre::Color::Red);
+
+    // on a transparent bitmap the edge color is not darkened
+    Gempyre::Bitmap clear(10, 10, Gempyre::Color::Transparent);
+    clear.fill_polygon({{0.5, 0}, {10, 0}, {10, 10}, {0.5, 10}}, Gempyre::Color::Red);
+    EXPECT_EQ(Gempyre::Color::r(clear.pixel(0, 5)), 0xFF);
+    EXPECT_NEAR(static_cast<int>(Gempyre::Color::alpha(clear.pixel(0, 5))), 0x80, 1);
+
+    // pentagram centre is encircled twice
+    std::vector<Gempyre::Point> star;
+    for(auto i = 0; i < 5; ++i) {
+        const auto angle = i * 4 * std::acos(-1.0) / 5;
+        star.push_back({10 + 9 * std::sin(angle), 10 - 9 * std::cos(angle)});
+    }
+    Gempyre::Bitmap even_odd(20, 20, Gempyre::Color::White);
+    even_odd.fill_polygon(star, Gempyre::Color::Blue, Gempyre::FillRule::EvenOdd);
+    EXPECT_EQ(even_odd.pixel(10, 10), Gempyre::Color::White);
+    EXPECT_EQ(even_odd.pixel(10, 6), Gempyre::Color::Blue);
+    Gempyre::Bitmap non_zero(20, 20, Gempyre::Color::White);
+    non_zero.fill_polygon(star, Gempyre::Color::Blue);
+    EXPECT_EQ(non_zero.pixel(10, 10), Gempyre::Color::Blue);
+    EXPECT_EQ(non_zero.pixel(10, 6), Gempyre::Color::Blue);
+    EXPECT_EQ(non_zero.pixel(0, 0), Gempyre::Color::White);
+
+    // far off-bitmap points beyond int range, as plot data may have
+    Gempyre::Bitmap far(20, 20, Gempyre::Color::White);
+    far.fill_polygon({{0, 0}, {10, 0}, {10, 3e9}}, Gempyre::Color::Red);
+    EXPECT_EQ(far.pixel(5, 5), Gempyre::Color::Red);
+    EXPECT_EQ(far.pixel(15, 5), Gempyre::Color::White);
+    far.fill_polygon({{0, -3e9}, {20, -3e9}, {20, 10}, {0, 10}}, Gempyre::Color::Blue);
+    EXPECT_EQ(far.pixel(19, 2), Gempyre::Color::Blue);
+    EXPECT_EQ(far.pixel(19, 12), Gempyre::Color::White);
+}
+
+TEST(Unittests, bitmap_stroke) {
+    Gempyre::Bitmap bmp(20, 20, Gempyre::Color::White);
+    bmp.draw_line({0, 5}, {10, 5}, Gempyre::Color::Red, 2);
+    EXPECT_EQ(bmp.pixel(0, 4), Gempyre::Color::Red);
+    EXPECT_EQ(bmp.pixel(9, 5), Gempyre::Color::Red);
+    EXPECT_EQ(bmp.pixel(5, 3), Gempyre::Color::White);
+    EXPECT_EQ(bmp.pixel(5, 6), Gempyre::Color::White);
+    EXPECT_EQ(bmp.pixel(10, 5), Gempyre::Color::White);
+
+    // translucent overlaps at the joint are not drawn twice
+    Gempyre::Bitmap poly(20, 20, Gempyre::Color::White);
+    poly.draw_polyline({{2, 10}, {18, 10}, {18, 18}}, Gempyre::Color::rgba(0, 0, 0xFF, 0x80), 4);
+    EXPECT_NE(poly.pixel(8, 10), Gempyre::Color::White);
+    EXPECT_EQ(poly.pixel(16, 11), poly.pixel(8, 10));
+    EXPECT_EQ(poly.pixel(17, 15), poly.pixel(8, 10));
+
+    Gempyre::Bitmap circles(20, 20, Gempyre::Color::White);
+    circles.draw_circle({10, 10}, 5.5, Gempyre::Color::Red);
+    EXPECT_EQ(Gempyre::Color::r(circles.pixel(10, 4)), 0xFF);
+    EXPECT_LT(Gempyre::Color::g(circles.pixel(10, 4)), 0x40U);
+    EXPECT_EQ(circles.pixel(10, 10), Gempyre::Color::White);
+    EXPECT_EQ(circles.pixel(10, 2), Gempyre::Color::White);
+    circles.fill_ellipse({10, 10}, 3, 2, Gempyre::Color::Green);
+    EXPECT_EQ(circles.pixel(11, 10), Gempyre::Color::Green);
+    EXPECT_EQ(circles.pixel(10, 13), Gempyre::Color::White);
+    EXPECT_EQ(circles.pixel(13, 10), Gempyre::Color::White);
+}
+
+TEST(Unittests, bitmap_copy_on_write) {
+    Gempyre::Bitmap bmp(4, 4, Gempyre::Color::Red);
+    auto copy = bmp;
+    EXPECT_EQ(copy.const_data(), bmp.const_data());   // shared until written
+    copy.set_pixel(1, 1, Gempyre::Color::Green);
+    EXPECT_NE(copy.const_data(), bmp.const_data());
+    EXPECT_EQ(bmp.pixel(1, 1), Gempyre::Color::Red);
+    EXPECT_EQ(copy.pixel(1, 1), Gempyre::Color::Green);
+
+    // sole owner writes in place
+    const auto pixels = copy.const_data();
+    copy.draw_rect({0, 0, 2, 2}, Gempyre::Color::Blue);
+    EXPECT_EQ(copy.const_data(), pixels);
+
+    // a copy is a separate bitmap, even if it shares the pixels
+    auto other = bmp;
+    bmp.merge(2, 2, other);
+    bmp.tile(-2, -2, other);
+    EXPECT_EQ(other.pixel(0, 0), Gempyre::Color::Red);
+    other.draw_line({0, 0}, {4, 4}, Gempyre::Color::White, 2);
+    EXPECT_EQ(bmp.pixel(2, 2), Gempyre::Color::Red);
+}
+
+TEST(Unittests, bitmap_image_io) {
+    Gempyre::Bitmap bmp(40, 30, Gempyre::Color::Blue);                      // runs
+    for(auto x = 0; x < bmp.width(); ++x)
+        bmp.set_pixel(x, 3, Gempyre::Color::rgba(x, x * 3, 255 - x * 6));   // diffs and lumas
+    bmp.set_pixel(5, 5, Gempyre::Color::rgba(1, 2, 3, 0x80));               // alpha
+    bmp.set_pixel(6, 5, Gempyre::Color::Blue);                              // index
+    bmp.draw_rect({10, 10, 15, 15}, Gempyre::Color::rgba(0xAA, 0x33, 0x11, 0));
+
+    const auto same = [&bmp](const Gempyre::Bitmap& other, bool alpha) {
+        for(auto y = 0; y < bmp.height(); ++y)
+            for(auto x = 0; x < bmp.width(); ++x) {
+                const auto p = bmp.pixel(x, y);
+                if(other.pixel(x, y) != (alpha ? p : Gempyre::Color::set_alpha(p, 0xFF)))
+                    return false;
+            }
+        return true;
+    };
+
+    const auto qoi = bmp.qoi_image();
+    EXPECT_LT(qoi.size(), static_cast<size_t>(bmp.width() * bmp.height()));
+    const Gempyre::Bitmap from_qoi(qoi);
+    EXPECT_EQ(from_qoi.width(), 40);
+    EXPECT_EQ(from_qoi.height(), 30);
+    EXPECT_TRUE(same(from_qoi, true));
+
+    EXPECT_TRUE(same(Gempyre::Bitmap(bmp.ppm_image()), false));
+    EXPECT_TRUE(same(Gempyre::Bitmap(bmp.pam_image()), true));
+
+    const char pgm[] = "P5\n# comment\n2 1\n65535\n\xFF\xFF\x80\x00";
+    const Gempyre::Bitmap gray(reinterpret_cast<const uint8_t*>(pgm), sizeof(pgm) - 1);
+    EXPECT_EQ(gray.pixel(0, 0), Gempyre::Color::White);
+    EXPECT_EQ(gray.pixel(1, 0), Gempyre::Color::rgba(0x80, 0x80, 0x80));
+    const char bits[] = "P5 2 1 1\n\x01\xC8";
+    const Gempyre::Bitmap clamped(reinterpret_cast<const uint8_t*>(bits), sizeof(bits) - 1);
+    EXPECT_EQ(clamped.pixel(0, 0), Gempyre::Color::White);
+    EXPECT_EQ(clamped.pixel(1, 0), Gempyre::Color::White); // above maxval
+
+    EXPECT_THROW(Gempyre::Bitmap(std::vector<uint8_t>(qoi.begin(), qoi.begin() + 20)), std::runtime_error);
+    // too short for its size, rejected before the pixels are allocated
+    const std::vector<uint8_t> huge{'q', 'o', 'i', 'f', 0, 0, 0x4E, 0x20, 0, 0, 0x4E, 0x20, 4, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+    EXPECT_THROW(Gempyre::Bitmap{huge}, std::runtime_error);
+    // RGB op without its bytes is not a run
+    const std::vector<uint8_t> cut{'q', 'o', 'i', 'f', 0, 0, 0, 2, 0, 0, 0, 1, 4, 0, 0xFE, 0x10, 0, 0, 0, 0, 0, 0, 0, 1};
+    EXPECT_THROW(Gempyre::Bitmap{cut}, std::runtime_error);
+    EXPECT_THROW(Gempyre::Bitmap(std::vector<uint8_t>{'P', '6', ' ', '0'}), std::runtime_error);
+
+    const auto name = GempyreUtils::temp_name() + ".qoi";
+    ASSERT_TRUE(bmp.save(name));
+    const auto loaded = Gempyre::Bitmap::load(name);
+    GempyreUtils::remove_file(name);
+    ASSERT_TRUE(loaded);
+    EXPECT_TRUE(same(*loaded, true));
+    EXPECT_FALSE(Gempyre::Bitmap::load(name));
+}
+
+TEST(Unittests, bitmap_pixel_formats) {
+    // odd width, so that the rows have both vectorized and scalar parts
+    Gempyre::Bitmap bmp(37, 5);
+    for(auto y = 0; y < bmp.height(); ++y)
+        for(auto x = 0; x < bmp.width(); ++x)
+            bmp.set_pixel(x, y, Gempyre::Color::rgba((x * 7) & 0xFF, (y * 50 + x) & 0xFF, (255 - x * 5) & 0xFF, (x * 13) & 0xFF));
+
+    const auto same = [](const Gempyre::Bitmap& a, const Gempyre::Bitmap& b) {
+        return a.width() == b.width() && a.height() == b.height() &&
+            std::memcmp(a.const_data(), b.const_data(), static_cast<size_t>(a.width() * a.height()) * sizeof(Gempyre::Color::type)) == 0;
+    };
+
+    const Gempyre::GrayBitmap gray(bmp);
+    ASSERT_EQ(gray.width(), 37);
+    ASSERT_EQ(gray.height(), 5);
+    const Gempyre::Rgb565Bitmap rgb565(bmp);
+    const Gempyre::BgraBitmap bgra(bmp);
+    for(auto y = 0; y < bmp.height(); ++y)
+        for(auto x = 0; x < bmp.width(); ++x) {
+            const auto p = bmp.pixel(x, y);
+            const auto r = Gempyre::Color::r(p), g = Gempyre::Color::g(p), b = Gempyre::Color::b(p);
+            ASSERT_EQ(gray.pixel(x, y), (r * 77 + g * 150 + b * 29 + 128) >> 8) << x << "," << y;
+            ASSERT_EQ(rgb565.pixel(x, y), ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)) << x << "," << y;
+            ASSERT_EQ(bgra.pixel(x, y), Gempyre::Color::rgba(b, g, r, Gempyre::Color::alpha(p))) << x << "," << y;
+        }
+    EXPECT_TRUE(same(bgra.to_bitmap(), bmp));
+
+    const auto from_gray = gray.to_bitmap();
+    EXPECT_EQ(from_gray.pixel(20, 3), Gempyre::Color::rgba(gray.pixel(20, 3), gray.pixel(20, 3), gray.pixel(20, 3)));
+    EXPECT_EQ(Gempyre::GrayBitmap(from_gray).pixel(20, 3), gray.pixel(20, 3));
+
+    // full range is kept, and a conversion back is exact
+    const auto from_565 = rgb565.to_bitmap();
+    EXPECT_EQ(Gempyre::Color::alpha(from_565.pixel(9, 2)), 0xFFU);
+    for(auto y = 0; y < bmp.height(); ++y)
+        for(auto x = 0; x < bmp.width(); ++x)
+            ASSERT_EQ(Gempyre::Rgb565Bitmap(from_565).pixel(x, y), rgb565.pixel(x, y));
+    Gempyre::Rgb565Bitmap white(9, 1);
+    std::fill(white.data(), white.data() + 9, 0xFFFF);
+    EXPECT_TRUE(same(white.to_bitmap(), Gempyre::Bitmap(9, 1, Gempyre::Color::White)));
+
+    // external buffer with a stride
+    const std::vector<uint32_t> frame(20 * 4, Gempyre::Color::rgba(3, 2, 1));
+    EXPECT_TRUE(same(Gempyre::BgraBitmap::to_bitmap(frame.data(), 10, 4, 20), Gempyre::Bitmap(10, 4, Gempyre::Color::rgba(1, 2, 3))));
+    EXPECT_TRUE(Gempyre::GrayBitmap().to_bitmap().empty());
+}
+
+TEST(Unittests, bitmap_rows) {
+    Gempyre::Bitmap bmp(10, 4, Gempyre::Color::Black);
+    auto row = bmp.row(2);
+    ASSERT_EQ(row.size(), 10U);
+    row[3] = Gempyre::Color::Red;
+    EXPECT_EQ(bmp.pixel(3, 2), Gempyre::Color::Red);
+    EXPECT_TRUE(bmp.row(4).empty());
+    EXPECT_TRUE(bmp.const_row(-1).empty());
+    EXPECT_TRUE(Gempyre::Bitmap().row(0).empty());
+    EXPECT_EQ(row.subspan(8, 5).size(), 2U);
+
+    int y = 0;
+    for(auto r : bmp.rows()) {
+        std::fill(r.begin(), r.end(), Gempyre::Color::rgb(static_cast<Gempyre::Color::type>(y), 0, 0));
+        ++y;
+    }
+    EXPECT_EQ(y, 4);
+    EXPECT_EQ(bmp.rows().size(), 4U);
+    EXPECT_EQ(bmp.pixel(9, 3), Gempyre::Color::rgb(3, 0, 0));
+    EXPECT_EQ(bmp.const_rows()[1][5], Gempyre::Color::rgb(1, 0, 0));
+    EXPECT_EQ(Gempyre::BitmapView(bmp, {2, 1, 3, 2}).rows()[1][0], Gempyre::Color::rgb(2, 0, 0));
+
+    // clipped to the bitmap
+    bmp.fill_row(-2, 0, 5, Gempyre::Color::Blue);
+    EXPECT_EQ(bmp.pixel(2, 0), Gempyre::Color::Blue);
+    EXPECT_EQ(bmp.pixel(3, 0), Gempyre::Color::rgb(0, 0, 0));
+    bmp.fill_row(8, 1, 100, Gempyre::Color::Green);
+    EXPECT_EQ(bmp.pixel(9, 1), Gempyre::Color::Green);
+    bmp.fill_row(0, 7, 10, Gempyre::Color::Green);
+    const std::array<Gempyre::Color::type, 4> pixels{Gempyre::Color::Red, Gempyre::Color::Green, Gempyre::Color::Blue, Gempyre::Color::White};
+    bmp.copy_row(-1, 3, pixels.data(), 4);
+    EXPECT_EQ(bmp.pixel(0, 3), Gempyre::Color::Green);
+    EXPECT_EQ(bmp.pixel(2, 3), Gempyre::Color::White);
+    bmp.copy_row(8, 3, pixels.data(), 4);
+    EXPECT_EQ(bmp.pixel(9, 3), Gempyre::Color::Green);
+    // nothing is written and nothing overflows
+    const auto before = bmp.clone();
+    bmp.copy_row(-1, 2, nullptr, 4);
+    bmp.fill_row(std::numeric_limits<int>::min(), 2, -5, Gempyre::Color::Red);
+    bmp.fill_row(std::numeric_limits<int>::min(), 2, std::numeric_limits<int>::max(), Gempyre::Color::Red);
+    bmp.copy_row(std::numeric_limits<int>::max(), 2, pixels.data(), std::numeric_limits<int>::max());
+    EXPECT_EQ(std::memcmp(before.const_data(), bmp.const_data(), static_cast<size_t>(bmp.width() * bmp.height()) * sizeof(Gempyre::Color::type)), 0);
+
+    // row access is a write, shared pixels are copied
+    const auto copy = bmp;
+    bmp.row(0)[0] = Gempyre::Color::White;
+    EXPECT_EQ(copy.pixel(0, 0), Gempyre::Color::Blue);
+    EXPECT_EQ(static_cast<const void*>(copy.const_row(0).data()), static_cast<const void*>(copy.const_data()));
+}
+
+TEST(Unittests, bitmap_row_access) {
+    const auto width = 37;
+    const auto height = 5;
+    const auto color = [](int x, int y) {return Gempyre::Color::rgb(static_cast<Gempyre::Color::type>(x * 7), static_cast<Gempyre::Color::type>(y * 31), 0x80);};
+    const auto same = [](const Gempyre::Bitmap& a, const Gempyre::Bitmap& b) {
+        return std::memcmp(a.const_data(), b.const_data(), static_cast<size_t>(a.width() * a.height()) * sizeof(Gempyre::Color::type)) == 0;
+    };
+
+    Gempyre::Bitmap by_pixel(width, height);
+    for(auto y = 0; y < height; ++y)
+        for(auto x = 0; x < width; ++x)
+            by_pixel.set_pixel(x, y, color(x, y));
+    Gempyre::Bitmap by_row(width, height);
+    auto y = 0;
+    for(auto row : by_row.rows()) {
+        for(auto x = 0; x < width; ++x)
+            row[static_cast<size_t>(x)] = color(x, y);
+        ++y;
+    }
+    EXPECT_EQ(y, height);
+    EXPECT_TRUE(same(by_pixel, by_row));
+
+    for(auto j = 0; j < height; ++j)
+        for(auto i = 3; i < width - 2; ++i)
+            by_pixel.set_pixel(i, j, Gempyre::Color::Red);
+    for(auto j = 0; j < height; ++j)
+        by_row.fill_row(3, j, width - 5, Gempyre::Color::Red);
+    EXPECT_TRUE(same(by_pixel, by_row));
+}
+
 int main(int argc, char **argv) {
    ::testing::InitGoogleTest(&argc, argv);
    for(int i = 1 ; i < argc; ++i) {